@@ -0,0 +1,377 @@
+#pragma once
+#include "meow_hash_file.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <ctime>
+#include <sys/file.h>
+
+/* A persistent cache of file hashes, on POSIX systems, built on top of meow_hash_file.hpp.
+ * The hashes are kept in a side file, mapped into memory and shared by every process that opens it, as a fixed size open addressing table
+ * keyed by the device, inode, size, and the modification and status change times of each file, with nanosecond precision.
+ * A file whose stat matches its entry is not read at all. Files changed within meow_cache_racy_window of being hashed aren't stored,
+ * since on file systems with coarse timestamps, a later change in the same tick wouldn't change the key, similarly to the racy entries of git's index.
+ * Entries are written under a per entry sequence lock, and carry a check value, so that concurrent readers, and entries torn by a crash, are never mistaken for valid ones.
+ * A slot left locked by a writer that died is taken over by the next writer that needs it. */
+
+namespace meowh
+{
+	/* Default number of entries in a new cache file, 144 MiB of slots. The size of an existing cache file is fixed when it's created.
+	 * An entry is only looked for in the few slots after the one its file hashes to, so the capacity should be about twice the number of files hashed through the cache,
+	 * or the files that don't fit keep replacing each other and are read again on every run. */
+	constexpr size_t meow_cache_capacity = 1024 * 1024;
+
+	// Default for how many nanoseconds a file has to be left unchanged before being hashed, for its hash to be stored. Until then, it's hashed again on every lookup.
+	constexpr int64_t meow_cache_racy_window = 2000000000;
+
+	namespace detail
+	{
+		constexpr char cache_magic[8] = { 'M', 'E', 'O', 'W', 'C', 'A', 'C', 'H' };
+		constexpr uint32_t cache_format = 1;
+
+		// Entries are looked for in this many slots, starting at the one the key hashes to.
+		constexpr size_t cache_probe_count = 8;
+
+		struct cache_header
+		{
+			char magic[8];
+			uint32_t format;
+			int32_t hash_version;
+			uint64_t capacity;
+			uint8_t reserved[40];
+		};
+
+		static_assert(sizeof(cache_header) == 64, "The cache header has to be 64 bytes.");
+
+		struct cache_key
+		{
+			uint64_t device;
+			uint64_t inode;
+			uint64_t size;
+			uint64_t seed;
+			int64_t mtime_sec;
+			int64_t mtime_nsec;
+			int64_t ctime_sec;
+			int64_t ctime_nsec;
+		};
+
+		struct cache_record
+		{
+			cache_key key;
+			uint8_t digest[64];
+			uint64_t check;
+		};
+
+		// The sequence is 0 for empty slots, odd while the record is being written, or if its writer died, and even otherwise.
+		struct cache_slot
+		{
+			std::atomic<uint64_t> sequence;
+			cache_record record;
+		};
+
+		static_assert(sizeof(cache_slot) == 144, "Cache slots have to be 144 bytes.");
+		static_assert(std::atomic<uint64_t>::is_always_lock_free, "The cache needs lock free 64-bit atomics to be shared between processes.");
+
+		inline cache_key make_cache_key(const struct stat& file_stat, uint64_t seed)
+		{
+#ifdef __APPLE__
+			const timespec& mtime = file_stat.st_mtimespec;
+			const timespec& ctime = file_stat.st_ctimespec;
+#else
+			const timespec& mtime = file_stat.st_mtim;
+			const timespec& ctime = file_stat.st_ctim;
+#endif
+			return cache_key { static_cast<uint64_t>(file_stat.st_dev), static_cast<uint64_t>(file_stat.st_ino), static_cast<uint64_t>(file_stat.st_size), seed,
+				static_cast<int64_t>(mtime.tv_sec), static_cast<int64_t>(mtime.tv_nsec), static_cast<int64_t>(ctime.tv_sec), static_cast<int64_t>(ctime.tv_nsec) };
+		}
+
+		inline bool same_key(const cache_key& a, const cache_key& b)
+		{
+			return std::memcmp(&a, &b, sizeof(cache_key)) == 0;
+		}
+
+		inline uint64_t record_check(const cache_record& record)
+		{
+			return meow_hash_impl<128, false, 64>(reinterpret_cast<const uint8_t*>(&record), offsetof(cache_record, check), cache_format)[0];
+		}
+
+		inline int64_t now_nsec()
+		{
+			timespec now;
+			::clock_gettime(CLOCK_REALTIME, &now);
+			return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+		}
+	}
+
+	/* A cache of file hashes in the side file at path, created with room for capacity entries, see meow_cache_capacity, if it doesn't exist. It can be opened by any number of
+	 * processes and threads at once. When it's full, new entries replace older ones. Files changed less than racy_window nanoseconds before being hashed aren't stored.
+	 * Throws std::system_error if the file can't be opened, or isn't a cache of this version. */
+	class meow_hash_cache
+	{
+	public:
+
+		explicit meow_hash_cache(const std::string& path, size_t capacity = meow_cache_capacity, int64_t racy_window = meow_cache_racy_window) :
+			file(::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)), racy_window(racy_window)
+		{
+			if (file.get() < 0)
+			{
+				detail::throw_file_error("meowh::meow_hash_cache: open");
+			}
+
+			// The header is written, or checked, under an exclusive lock, so that processes creating the same cache at once don't see it half initialized.
+			while (::flock(file.get(), LOCK_EX) != 0)
+			{
+				if (errno != EINTR)
+				{
+					detail::throw_file_error("meowh::meow_hash_cache: flock");
+				}
+			}
+
+			struct stat file_stat;
+			detail::cache_header header = {};
+
+			if (::fstat(file.get(), &file_stat) != 0)
+			{
+				detail::throw_file_error("meowh::meow_hash_cache: fstat");
+			}
+
+			// A file that was sized but whose header was never written, because the process creating it died in between, has a header of zeros, and is initialized again like an empty one.
+			size_t header_len = detail::read_fully(file.get(), reinterpret_cast<uint8_t*>(&header), sizeof(header), 0);
+			const uint8_t* header_bytes = reinterpret_cast<const uint8_t*>(&header);
+
+			if (std::all_of(header_bytes, header_bytes + sizeof(header), [](uint8_t b) { return b == 0; }))
+			{
+				std::memcpy(header.magic, detail::cache_magic, sizeof(header.magic));
+				header.format = detail::cache_format;
+				header.hash_version = meow_hash_version;
+				header.capacity = std::max<size_t>(capacity, detail::cache_probe_count);
+
+				if (::ftruncate(file.get(), static_cast<off_t>(sizeof(header) + header.capacity * sizeof(detail::cache_slot))) != 0 ||
+					::pwrite(file.get(), &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+				{
+					detail::throw_file_error("meowh::meow_hash_cache: initializing the cache file");
+				}
+			}
+			else if (header_len != sizeof(header) ||
+				std::memcmp(header.magic, detail::cache_magic, sizeof(header.magic)) != 0 || header.format != detail::cache_format ||
+				header.hash_version != meow_hash_version || header.capacity < detail::cache_probe_count ||
+				static_cast<uint64_t>(file_stat.st_size) < sizeof(header) + header.capacity * sizeof(detail::cache_slot))
+			{
+				errno = EINVAL;
+				detail::throw_file_error("meowh::meow_hash_cache: not a cache file of this version");
+			}
+
+			::flock(file.get(), LOCK_UN);
+
+			slot_count = static_cast<size_t>(header.capacity);
+			map_size = sizeof(header) + slot_count * sizeof(detail::cache_slot);
+
+			void* map = ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, file.get(), 0);
+
+			if (map == MAP_FAILED)
+			{
+				detail::throw_file_error("meowh::meow_hash_cache: mmap");
+			}
+
+			slots = reinterpret_cast<detail::cache_slot*>(reinterpret_cast<uint8_t*>(map) + sizeof(header));
+		}
+
+		meow_hash_cache(const meow_hash_cache&) = delete;
+		meow_hash_cache& operator=(const meow_hash_cache&) = delete;
+
+		~meow_hash_cache()
+		{
+			::munmap(reinterpret_cast<uint8_t*>(slots) - sizeof(detail::cache_header), map_size);
+		}
+
+		// Gives the same result as meowh::hash_file<N, R>(path, seed), without opening the file if its stat matches a cached entry.
+		template <size_t N = 128, size_t R = N>
+		hash_t<R> hash_file(const std::string& path, uint64_t seed = 0)
+		{
+			struct stat file_stat;
+			hash_t<R> result;
+
+			if (::stat(path.c_str(), &file_stat) == 0 && S_ISREG(file_stat.st_mode) && find(detail::make_cache_key(file_stat, seed), result))
+			{
+				hit_count++;
+				return result;
+			}
+
+			detail::file_handle file(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+
+			if (file.get() < 0)
+			{
+				detail::throw_file_error("meowh::hash_file: open");
+			}
+
+			return hash_open_file<N, R>(file.get(), seed);
+		}
+
+		// Gives the same result as meowh::hash_file<N, R>(fd, seed), without reading the file if its stat matches a cached entry.
+		template <size_t N = 128, size_t R = N>
+		hash_t<R> hash_file(int fd, uint64_t seed = 0)
+		{
+			struct stat file_stat;
+			hash_t<R> result;
+
+			if (::fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode) && find(detail::make_cache_key(file_stat, seed), result))
+			{
+				hit_count++;
+				return result;
+			}
+
+			return hash_open_file<N, R>(fd, seed);
+		}
+
+		// Number of files whose hash was found in the cache, by this instance.
+		uint64_t hits() const
+		{
+			return hit_count;
+		}
+
+		// Number of files that had to be read, by this instance.
+		uint64_t misses() const
+		{
+			return miss_count;
+		}
+
+		size_t capacity() const
+		{
+			return slot_count;
+		}
+
+	private:
+
+		// Hashes the file, and stores its hash if the file didn't change while it was being read, and wasn't changed too recently.
+		template <size_t N, size_t R>
+		hash_t<R> hash_open_file(int fd, uint64_t seed)
+		{
+			struct stat before;
+			struct stat after;
+
+			miss_count++;
+
+			int64_t start = detail::now_nsec();
+			bool cacheable = ::fstat(fd, &before) == 0 && S_ISREG(before.st_mode);
+
+			hash_t<R> result = meowh::hash_file<N, R>(fd, seed);
+
+			if (cacheable && ::fstat(fd, &after) == 0)
+			{
+				detail::cache_key key = detail::make_cache_key(before, seed);
+				int64_t changed = std::max(key.mtime_sec * 1000000000 + key.mtime_nsec, key.ctime_sec * 1000000000 + key.ctime_nsec);
+
+				if (detail::same_key(key, detail::make_cache_key(after, seed)) && changed + racy_window <= start)
+				{
+					store(key, result);
+				}
+			}
+
+			return result;
+		}
+
+		size_t first_slot(const detail::cache_key& key) const
+		{
+			uint64_t mix = (key.device * 0x9E3779B97F4A7C15ULL) ^ key.inode;
+			mix ^= mix >> 31;
+			mix *= 0xBF58476D1CE4E5B9ULL;
+			mix ^= mix >> 29;
+			return static_cast<size_t>(mix % slot_count);
+		}
+
+		// Copies the record of a slot, returning false if it's empty, being written, or not a valid record.
+		static bool read_slot(const detail::cache_slot& slot, detail::cache_record& record, uint64_t& sequence)
+		{
+			sequence = slot.sequence.load(std::memory_order_acquire);
+
+			if (sequence == 0 || sequence % 2 != 0)
+			{
+				return false;
+			}
+
+			std::memcpy(&record, &slot.record, sizeof(record));
+			std::atomic_thread_fence(std::memory_order_acquire);
+
+			return slot.sequence.load(std::memory_order_relaxed) == sequence && detail::record_check(record) == record.check;
+		}
+
+		template <size_t R>
+		bool find(const detail::cache_key& key, hash_t<R>& result) const
+		{
+			size_t first = first_slot(key);
+
+			for (size_t p = 0; p < detail::cache_probe_count; p++)
+			{
+				const detail::cache_slot& slot = slots[(first + p) % slot_count];
+				detail::cache_record record;
+				uint64_t sequence;
+
+				if (read_slot(slot, record, sequence) && detail::same_key(record.key, key))
+				{
+					std::memcpy(reinterpret_cast<void*>(result.elem.data()), record.digest, 64);
+					return true;
+				}
+				else if (sequence == 0)
+				{
+					return false;
+				}
+			}
+
+			return false;
+		}
+
+		/* Stores the hash in the slot of the same file, or an empty or unreadable one, or replaces the first slot the key hashes to.
+		 * A writer can't tell whether a locked slot's writer is still running or died, so it takes the slot over. If both write the slot at once,
+		 * the record can be left torn, which fails its check and is read as a miss, and is replaced by the next store. */
+		template <size_t R>
+		void store(const detail::cache_key& key, const hash_t<R>& hash)
+		{
+			size_t first = first_slot(key);
+			detail::cache_slot* target = &slots[first];
+
+			for (size_t p = 0; p < detail::cache_probe_count; p++)
+			{
+				detail::cache_slot& slot = slots[(first + p) % slot_count];
+				detail::cache_record record;
+				uint64_t sequence;
+
+				if (!read_slot(slot, record, sequence) || (record.key.device == key.device && record.key.inode == key.inode))
+				{
+					target = &slot;
+					break;
+				}
+			}
+
+			// The slot is locked with the next odd sequence, whether it was unlocked or left locked, and gives up only if another writer locks it first.
+			uint64_t sequence = target->sequence.load(std::memory_order_relaxed);
+			uint64_t locked = sequence % 2 == 0 ? sequence + 1 : sequence + 2;
+
+			if (!target->sequence.compare_exchange_strong(sequence, locked, std::memory_order_acquire))
+			{
+				return;
+			}
+
+			// Keeps the record from being written before the slot is seen to be locked.
+			std::atomic_thread_fence(std::memory_order_release);
+
+			detail::cache_record record;
+			record.key = key;
+			std::memcpy(record.digest, reinterpret_cast<const void*>(hash.elem.data()), 64);
+			record.check = detail::record_check(record);
+
+			std::memcpy(&target->record, &record, sizeof(record));
+
+			// If another writer took the slot over meanwhile, this moves its sequence back to an even one, but still not to the one it had before either write,
+			// so readers that overlapped either of them retry, and a record mixed from both fails its check value.
+			target->sequence.store(locked + 1, std::memory_order_release);
+		}
+
+		detail::file_handle file;
+		int64_t racy_window;
+		size_t slot_count = 0;
+		size_t map_size = 0;
+		detail::cache_slot* slots = nullptr;
+		std::atomic<uint64_t> hit_count { 0 };
+		std::atomic<uint64_t> miss_count { 0 };
+	};
+}
@@ -0,0 +1,369 @@
+#pragma once
+#include "meow_hash.hpp"
+
+#include <cerrno>
+#include <future>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* File hashing on POSIX systems, built on top of meow_hash.hpp.
+ * Regular files are mapped into memory and hashed in place, without copying them into a buffer first.
+ * Where the system supports SEEK_DATA and SEEK_HOLE, the holes of sparse files are hashed without reading them.
+ * Everything that can't be mapped is read in chunks into a meow_state. Input of unknown length, like pipes, is hashed like meow_hash if it ends
+ * within the first chunk, and otherwise with MeowStream, in constant memory, since the length of the input is a part of the initialization vector
+ * of meow_hash and has to be known before hashing the first block.
+ * Errors are reported by throwing std::system_error with the errno of the failed call. */
+
+namespace meowh
+{
+	// Size of the reads used for files that can't be mapped.
+	constexpr size_t meow_file_chunk_size = 1024 * 1024;
+
+	/* Passed to hash_file as N, picks the widest kernel the machine supports for input that's mapped or read into memory in full, through meow_hash_dispatch,
+	 * so a program built for baseline x86-64 still hashes large files with VAES. Files that are read in chunks go through the 128 bit kernel. */
+	constexpr size_t meow_file_dispatch = 0;
+
+	namespace detail
+	{
+		[[noreturn]] inline void throw_file_error(const char* what)
+		{
+			throw std::system_error(errno, std::generic_category(), what);
+		}
+
+		// The kernel width used by meow_state for a hash_file width of N.
+		template <size_t N>
+		constexpr size_t file_state_width = N == meow_file_dispatch ? 128 : N;
+
+		// Hashes input that's in memory in full, through meow_hash_dispatch if N is meow_file_dispatch.
+		template <size_t N, size_t R>
+		MEOWH_FORCE_STATIC_INLINE hash_t<R> hash_file_bytes(const uint8_t* src, size_t len, uint64_t seed)
+		{
+#ifdef _MEOWH_DISPATCH
+			if constexpr (N == meow_file_dispatch)
+			{
+				return meow_hash_dispatch<R>(src, len, seed);
+			}
+			else
+#endif
+			{
+				return meow_hash_impl<N, false, R>(src, len, seed);
+			}
+		}
+
+		// Owns a file descriptor opened by hash_file, and closes it when going out of scope.
+		class file_handle
+		{
+		public:
+
+			explicit file_handle(int fd) : fd(fd) {}
+
+			file_handle(const file_handle&) = delete;
+			file_handle& operator=(const file_handle&) = delete;
+
+			~file_handle()
+			{
+				if (fd >= 0)
+				{
+					::close(fd);
+				}
+			}
+
+			int get() const
+			{
+				return fd;
+			}
+
+		private:
+
+			int fd;
+		};
+
+		// Reads up to len bytes at offset, or from the current position for offset < 0, retrying on EINTR and short reads. Returns less than len only at the end of the file.
+		inline size_t read_fully(int fd, uint8_t* dst, size_t len, int64_t offset)
+		{
+			size_t total = 0;
+
+			while (total < len)
+			{
+				ssize_t ret = offset < 0 ? ::read(fd, dst + total, len - total) : ::pread(fd, dst + total, len - total, static_cast<off_t>(offset + total));
+
+				if (ret < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					throw_file_error("meowh::hash_file: read");
+				}
+				else if (ret == 0)
+				{
+					break;
+				}
+
+				total += static_cast<size_t>(ret);
+			}
+
+			return total;
+		}
+
+		/* Maps the first size bytes of the file and hashes them in place. Returns false, without hashing, if the file can't be mapped,
+		 * which happens for some special files with a regular file type. */
+		template <size_t N, size_t R>
+		static bool hash_file_mapped(int fd, uint64_t size, uint64_t seed, hash_t<R>& result)
+		{
+			void* map = ::mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+			if (map == MAP_FAILED)
+			{
+				return false;
+			}
+
+			::madvise(map, static_cast<size_t>(size), MADV_SEQUENTIAL);
+			::madvise(map, static_cast<size_t>(size), MADV_WILLNEED);
+
+			result = hash_file_bytes<N, R>(reinterpret_cast<const uint8_t*>(map), static_cast<size_t>(size), seed);
+
+			::munmap(map, static_cast<size_t>(size));
+			return true;
+		}
+
+		/* Hashes a file of a known size by reading it in chunks into a meow_state, which carries the hash streams from one chunk to the next.
+		 * Before each chunk is hashed, the kernel is asked to start reading the next one, so that the disk works while the chunk is being hashed.
+		 * It's deliberately single-buffered: the readahead already overlaps the disk with the hashing, and the read that follows only copies
+		 * the chunk out of the page cache, which a second buffer and thread wouldn't make any cheaper. */
+		template <size_t N, size_t R>
+		static hash_t<R> hash_file_chunked(int fd, uint64_t size, uint64_t seed)
+		{
+			meow_state<file_state_width<N>, R> state(size, seed);
+			std::vector<uint8_t> buffer(static_cast<size_t>(std::min<uint64_t>(size, meow_file_chunk_size)));
+
+			::posix_fadvise(fd, 0, static_cast<off_t>(size), POSIX_FADV_SEQUENTIAL);
+
+			for (uint64_t offset = 0; offset < size;)
+			{
+				size_t chunk_len = static_cast<size_t>(std::min<uint64_t>(size - offset, buffer.size()));
+
+				if (read_fully(fd, buffer.data(), chunk_len, static_cast<int64_t>(offset)) != chunk_len)
+				{
+					errno = EIO;
+					throw_file_error("meowh::hash_file: file shrank while being hashed");
+				}
+
+				if (offset + chunk_len < size)
+				{
+					::posix_fadvise(fd, static_cast<off_t>(offset + chunk_len), static_cast<off_t>(std::min<uint64_t>(size - offset - chunk_len, buffer.size())), POSIX_FADV_WILLNEED);
+				}
+
+				state.absorb(buffer.data(), chunk_len);
+				offset += chunk_len;
+			}
+
+			return state.finalize();
+		}
+
+#ifdef SEEK_DATA
+		// Puts the file offset of fd back where it was when going out of scope, for functions that have to seek in a file descriptor owned by the caller.
+		class file_offset_guard
+		{
+		public:
+
+			explicit file_offset_guard(int fd) : fd(fd), offset(::lseek(fd, 0, SEEK_CUR)) {}
+
+			file_offset_guard(const file_offset_guard&) = delete;
+			file_offset_guard& operator=(const file_offset_guard&) = delete;
+
+			~file_offset_guard()
+			{
+				if (offset >= 0)
+				{
+					::lseek(fd, offset, SEEK_SET);
+				}
+			}
+
+		private:
+
+			int fd;
+			off_t offset;
+		};
+
+		/* Hashes a file with holes, finding them with SEEK_DATA and SEEK_HOLE. The holes are absorbed with meow_state::absorb_zeros,
+		 * which never touches memory, and only the data is read, from a mapping of the whole file if possible. The file offset is left as it was. */
+		template <size_t N, size_t R>
+		static hash_t<R> hash_file_sparse(int fd, uint64_t size, uint64_t seed)
+		{
+			file_offset_guard offset_guard(fd);
+			meow_state<file_state_width<N>, R> state(size, seed);
+
+			void* map = size <= SIZE_MAX ? ::mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+			std::vector<uint8_t> buffer;
+
+			if (map == MAP_FAILED)
+			{
+				buffer.resize(static_cast<size_t>(std::min<uint64_t>(size, meow_file_chunk_size)));
+			}
+
+			try
+			{
+				for (uint64_t offset = 0; offset < size;)
+				{
+					off_t data = ::lseek(fd, static_cast<off_t>(offset), SEEK_DATA);
+
+					// ENXIO means that the rest of the file is a hole, and file systems without hole support report everything as data, or fail with EINVAL.
+					if (data < 0 && errno == ENXIO)
+					{
+						data = static_cast<off_t>(size);
+					}
+					else if (data < 0)
+					{
+						data = static_cast<off_t>(offset);
+					}
+
+					off_t hole = data < static_cast<off_t>(size) ? ::lseek(fd, data, SEEK_HOLE) : static_cast<off_t>(size);
+					uint64_t data_end = hole < 0 ? size : std::min<uint64_t>(static_cast<uint64_t>(hole), size);
+					uint64_t data_begin = std::min<uint64_t>(static_cast<uint64_t>(data), size);
+
+					state.absorb_zeros(data_begin - offset);
+
+					for (offset = data_begin; offset < data_end;)
+					{
+						uint64_t chunk_limit = map == MAP_FAILED ? buffer.size() : data_end - offset;
+						size_t chunk_len = static_cast<size_t>(std::min<uint64_t>(data_end - offset, chunk_limit));
+
+						if (map != MAP_FAILED)
+						{
+							state.absorb(reinterpret_cast<const uint8_t*>(map) + offset, chunk_len);
+						}
+						else if (read_fully(fd, buffer.data(), chunk_len, static_cast<int64_t>(offset)) == chunk_len)
+						{
+							state.absorb(buffer.data(), chunk_len);
+						}
+						else
+						{
+							errno = EIO;
+							throw_file_error("meowh::hash_file: file shrank while being hashed");
+						}
+
+						offset += chunk_len;
+					}
+				}
+			}
+			catch (...)
+			{
+				if (map != MAP_FAILED)
+				{
+					::munmap(map, static_cast<size_t>(size));
+				}
+				throw;
+			}
+
+			if (map != MAP_FAILED)
+			{
+				::munmap(map, static_cast<size_t>(size));
+			}
+
+			return state.finalize();
+		}
+#endif
+
+		/* Hashes everything that can be read from fd, starting at its current position, for input whose length isn't known up front.
+		 * Input that ends within the first chunk is hashed like meow_hash, since its length is known by then. Longer input can't be,
+		 * without keeping all of it, so it's hashed with MeowStream, in constant memory: the chunks are read into two buffers in turn,
+		 * and the next one is read on another thread while the current one is absorbed into the meow_stream. */
+		template <size_t N, size_t R>
+		static hash_t<R> hash_file_stream(int fd, uint64_t seed)
+		{
+			std::vector<uint8_t> buffers[2] = { std::vector<uint8_t>(meow_file_chunk_size), std::vector<uint8_t>() };
+			size_t len = read_fully(fd, buffers[0].data(), meow_file_chunk_size, -1);
+
+			if (len < meow_file_chunk_size)
+			{
+				return hash_file_bytes<N, R>(buffers[0].data(), len, seed);
+			}
+
+			meow_stream<file_state_width<N>, R> stream(seed);
+			size_t current = 0;
+			buffers[1].resize(meow_file_chunk_size);
+
+			while (len == meow_file_chunk_size)
+			{
+				uint8_t* next_buffer = buffers[current ^ 1].data();
+				std::future<size_t> next = std::async(std::launch::async, [fd, next_buffer]() { return read_fully(fd, next_buffer, meow_file_chunk_size, -1); });
+
+				stream.absorb(buffers[current].data(), len);
+				len = next.get();
+				current ^= 1;
+			}
+
+			stream.absorb(buffers[current].data(), len);
+			return stream.finalize();
+		}
+	}
+
+	/* Hashes the contents of an open file, giving the same result as meow_hash<N, false, R> over its bytes. N can also be meow_file_dispatch, together with an explicit R.
+	 * Regular files are hashed from the beginning, regardless of the current position, which is left unchanged. Special files, like pipes, are hashed
+	 * from the current position until the end of input, and since their length isn't known up front, only input shorter than meow_file_chunk_size
+	 * gives the result of meow_hash. Longer input gives the result of meow_stream<N, R>, with 128 for meow_file_dispatch, and is hashed in constant memory.
+	 * meow_pipe_hasher hashes pipes of a known length like meow_hash, without buffering them. */
+	template <size_t N = 128, size_t R = N>
+	hash_t<R> hash_file(int fd, uint64_t seed = 0)
+	{
+#ifdef _MEOWH_DISPATCH
+		static_assert(N == meow_file_dispatch || N == 128 || N == 256 || N == 512, "hash_file can only be called in 128, 256, 512 bit, or dispatch mode.");
+#else
+		static_assert(N == 128 || N == 256 || N == 512, "hash_file can only be called in 128, 256, or 512 bit mode.");
+#endif
+
+		struct stat file_stat;
+
+		if (::fstat(fd, &file_stat) != 0)
+		{
+			detail::throw_file_error("meowh::hash_file: fstat");
+		}
+
+		// Files in /proc and /sys report a size of 0, so only the size of non-empty regular files is trusted.
+		if (!S_ISREG(file_stat.st_mode) || file_stat.st_size == 0)
+		{
+			return detail::hash_file_stream<N, R>(fd, seed);
+		}
+
+		uint64_t size = static_cast<uint64_t>(file_stat.st_size);
+		hash_t<R> result;
+
+#ifdef SEEK_DATA
+		// Files with fewer blocks allocated than their size have holes, which are hashed without reading them.
+		if (static_cast<uint64_t>(file_stat.st_blocks) * 512 < size)
+		{
+			return detail::hash_file_sparse<N, R>(fd, size, seed);
+		}
+#endif
+
+		if (size <= SIZE_MAX && detail::hash_file_mapped<N, R>(fd, size, seed, result))
+		{
+			return result;
+		}
+
+		return detail::hash_file_chunked<N, R>(fd, size, seed);
+	}
+
+	template <size_t N = 128, size_t R = N>
+	hash_t<R> hash_file(const char* path, uint64_t seed = 0)
+	{
+		detail::file_handle file(::open(path, O_RDONLY | O_CLOEXEC));
+
+		if (file.get() < 0)
+		{
+			detail::throw_file_error("meowh::hash_file: open");
+		}
+
+		return hash_file<N, R>(file.get(), seed);
+	}
+
+	template <size_t N = 128, size_t R = N>
+	hash_t<R> hash_file(const std::string& path, uint64_t seed = 0)
+	{
+		return hash_file<N, R>(path.c_str(), seed);
+	}
+}
@@ -3,9 +3,19 @@
 #include <array>
 #include <cstring>
 #include <vector>
+#include <deque>
 #include <initializer_list>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <algorithm>
+#include <utility>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <system_error>
 
 #ifdef _MSC_VER
 #include <intrin.h>
@@ -156,8 +166,74 @@ any persistent hash values stored in codebases, databases, etc.
 #endif // __GNUC__
 
 
+/* Runtime dispatch between MeowHash1, 2 and 4 from a single binary.
+ * gcc and clang always declare the wider vector types and allow using them in functions with a matching target attribute,
+ * so each kernel is compiled for its own instruction set regardless of the flags the rest of the program is built with.
+ * Visual Studio allows using any intrinsic in any function, so no attributes are needed there. */
+#if defined(_MSC_VER) && (defined(_M_AMD64) || defined(_M_X64))
+#define _MEOWH_DISPATCH
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || __GNUC__ >= 8)
+#define _MEOWH_DISPATCH
+#endif
+
+#if defined(__GNUC__) && defined(_MEOWH_DISPATCH)
+#define MEOWH_FLATTEN __attribute__((flatten))
+#define MEOWH_TARGET_AES __attribute__((target("sse2,aes")))
+#define MEOWH_TARGET_VAES_256 __attribute__((target("avx2,aes,vaes")))
+#define MEOWH_TARGET_VAES_512 __attribute__((target("avx512f,aes,vaes")))
+#else
+#define MEOWH_FLATTEN
+#define MEOWH_TARGET_AES
+#define MEOWH_TARGET_VAES_256
+#define MEOWH_TARGET_VAES_512
+#endif
+
+/* The instruction wrappers carry the target attributes of their kernel, so that the dispatch kernels, which are flattened, can inline them in any build.
+ * Anywhere else, a wrapper for an instruction set the program isn't compiled for can't be inlined, and every AES round would become a call,
+ * so optimized builds reject such calls instead, like they did before the wrappers had target attributes. Use meow_hash_dispatch, or compile with -maes, -mvaes and -mavx2 or -mavx512f. */
+#if defined(__GNUC__) && defined(_MEOWH_DISPATCH) && defined(__OPTIMIZE__) && defined(__has_attribute)
+#if __has_attribute(error)
+#define MEOWH_REQUIRE_ISA(flags) __attribute__((error("meowh: this kernel needs " flags " at compile time, or meow_hash_dispatch")))
+#endif
+#endif
+
+#ifdef MEOWH_REQUIRE_ISA
+#ifdef __AES__
+#define MEOWH_INLINE_AES MEOWH_TARGET_AES
+#else
+#define MEOWH_INLINE_AES MEOWH_TARGET_AES MEOWH_REQUIRE_ISA("-maes")
+#endif
+#if defined(__VAES__) && defined(__AVX2__)
+#define MEOWH_INLINE_VAES_256 MEOWH_TARGET_VAES_256
+#else
+#define MEOWH_INLINE_VAES_256 MEOWH_TARGET_VAES_256 MEOWH_REQUIRE_ISA("-mvaes -mavx2")
+#endif
+#if defined(__VAES__) && defined(__AVX512F__)
+#define MEOWH_INLINE_VAES_512 MEOWH_TARGET_VAES_512
+#else
+#define MEOWH_INLINE_VAES_512 MEOWH_TARGET_VAES_512 MEOWH_REQUIRE_ISA("-mvaes -mavx512f")
+#endif
+#else
+#define MEOWH_INLINE_AES MEOWH_TARGET_AES
+#define MEOWH_INLINE_VAES_256 MEOWH_TARGET_VAES_256
+#define MEOWH_INLINE_VAES_512 MEOWH_TARGET_VAES_512
+#endif
+
+
 
 
+/* The kernels pass wider vectors between functions compiled for different targets,
+ * which is harmless since they all get inlined into a single function with the widest target.
+ * The wider vector types are also declared in builds without -mavx2 or -mavx512f, and gcc warns that their alignment
+ * attributes are dropped wherever they're used as template arguments, like in hash_t, where only their size matters. */
+#if defined(__GNUC__) && !defined(__clang__) && defined(_MEOWH_DISPATCH)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#pragma GCC diagnostic ignored "-Wignored-attributes"
+#endif
+
 namespace meowh
 {
 	namespace types
@@ -183,14 +259,14 @@ namespace meowh
 #endif
 
 		// ymm
-#ifdef _MEOWH_256
+#if defined(_MEOWH_256) || defined(_MEOWH_DISPATCH)
 		using hash_256_underlying = __m256i;
 		template <>
 		struct hash_type<256> { using type = hash_256_underlying; };
 #endif
 
 		// zmm
-#ifdef _MEOWH_512
+#if defined(_MEOWH_512) || defined(_MEOWH_DISPATCH)
 		using hash_512_underlying = __m512i;
 		template <>
 		struct hash_type<512> { using type = hash_512_underlying; };
@@ -217,6 +293,8 @@ namespace meowh
 
 		hash_t() {};
 
+		constexpr explicit hash_t(const std::array<hash_type_t<N>, 512 / N>& other) : elem(other) {};
+
 		template <size_t A>
 		hash_t<N>& operator= (const hash_t<A>& other)
 		{
@@ -237,12 +315,12 @@ namespace meowh
 			return *this;
 		}
 
-		hash_type_t<N>& operator[](size_t n)
+		constexpr hash_type_t<N>& operator[](size_t n)
 		{
 			return elem[n];
 		}
 
-		const hash_type_t<N>& operator[](size_t n) const
+		constexpr const hash_type_t<N>& operator[](size_t n) const
 		{
 			return elem[n];
 		}
@@ -294,24 +372,118 @@ namespace meowh
 			return val;
 		}
 
+		// Instruction wrappers carrying the target attributes of their kernel, see _MEOWH_DISPATCH and MEOWH_REQUIRE_ISA.
+		MEOWH_INLINE_AES MEOWH_FORCE_STATIC_INLINE hash_type_t<128> aesdec_128(hash_type_t<128> a, hash_type_t<128> b)
+		{
+			return _mm_aesdec_si128(a, b);
+		}
+
+		MEOWH_INLINE_AES MEOWH_FORCE_STATIC_INLINE hash_type_t<128> aesdec_128(hash_type_t<128> a, const uint8_t* src)
+		{
+			return _mm_aesdec_si128(a, unaligned_read<128>(src));
+		}
+
+#if defined(_MEOWH_256) || defined(_MEOWH_DISPATCH)
+		MEOWH_INLINE_VAES_256 MEOWH_FORCE_STATIC_INLINE hash_type_t<256> aesdec_256(hash_type_t<256> a, hash_type_t<256> b)
+		{
+			return _mm256_aesdec_epi128(a, b);
+		}
+
+		MEOWH_INLINE_VAES_256 MEOWH_FORCE_STATIC_INLINE hash_type_t<256> aesdec_256(hash_type_t<256> a, const uint8_t* src)
+		{
+			hash_type_t<256> val;
+			std::memcpy(reinterpret_cast<void*>(&val), src, sizeof(val));
+			return _mm256_aesdec_epi128(a, val);
+		}
+
+		// Rotates the four 128 bit lanes held in a pair of ymm registers down by one.
+		MEOWH_TARGET_VAES_256 MEOWH_FORCE_STATIC_INLINE void lane_rotate_256(hash_type_t<256>& lo, hash_type_t<256>& hi)
+		{
+			hash_type_t<256> tmp = lo;
+			lo = _mm256_permute2x128_si256(lo, hi, 0x21);
+			hi = _mm256_permute2x128_si256(hi, tmp, 0x21);
+		}
+#endif
+
+#if defined(_MEOWH_512) || defined(_MEOWH_DISPATCH)
+		MEOWH_INLINE_VAES_512 MEOWH_FORCE_STATIC_INLINE hash_type_t<512> aesdec_512(hash_type_t<512> a, hash_type_t<512> b)
+		{
+			return _mm512_aesdec_epi128(a, b);
+		}
+
+		MEOWH_INLINE_VAES_512 MEOWH_FORCE_STATIC_INLINE hash_type_t<512> aesdec_512(hash_type_t<512> a, const uint8_t* src)
+		{
+			hash_type_t<512> val;
+			std::memcpy(reinterpret_cast<void*>(&val), src, sizeof(val));
+			return _mm512_aesdec_epi128(a, val);
+		}
+
+		MEOWH_TARGET_VAES_512 MEOWH_FORCE_STATIC_INLINE hash_type_t<512> lane_rotate_512(hash_type_t<512> a)
+		{
+			// The masked form doesn't read an undefined source register, which gcc warns about otherwise.
+			return _mm512_mask_shuffle_i64x2(a, static_cast<__mmask8>(0xFF), a, a, _MM_SHUFFLE(0, 3, 2, 1));
+		}
+#endif
+
+		/* Helpers for the transposed layout used by meow_hash_batch, where each 128 bit element of a vector belongs to a different message.
+		 * load_lanes_N builds a vector from 16 bytes at each of src[k] + offset, and set_lanes_N from pairs of 64 bit halves. */
+		MEOWH_FORCE_STATIC_INLINE hash_type_t<128> load_lanes_128(const uint8_t* const* src, size_t offset)
+		{
+			return unaligned_read<128>(src[0] + offset);
+		}
+
+		MEOWH_FORCE_STATIC_INLINE hash_type_t<128> set_lanes_128(const uint64_t* lo, const uint64_t* hi)
+		{
+			return _mm_set_epi64x(static_cast<int64_t>(hi[0]), static_cast<int64_t>(lo[0]));
+		}
+
+#if defined(_MEOWH_256) || defined(_MEOWH_DISPATCH)
+		MEOWH_TARGET_VAES_256 MEOWH_FORCE_STATIC_INLINE hash_type_t<256> load_lanes_256(const uint8_t* const* src, size_t offset)
+		{
+			return _mm256_inserti128_si256(_mm256_castsi128_si256(unaligned_read<128>(src[0] + offset)), unaligned_read<128>(src[1] + offset), 1);
+		}
+
+		MEOWH_TARGET_VAES_256 MEOWH_FORCE_STATIC_INLINE hash_type_t<256> set_lanes_256(const uint64_t* lo, const uint64_t* hi)
+		{
+			return _mm256_set_epi64x(static_cast<int64_t>(hi[1]), static_cast<int64_t>(lo[1]), static_cast<int64_t>(hi[0]), static_cast<int64_t>(lo[0]));
+		}
+#endif
+
+#if defined(_MEOWH_512) || defined(_MEOWH_DISPATCH)
+		MEOWH_TARGET_VAES_512 MEOWH_FORCE_STATIC_INLINE hash_type_t<512> load_lanes_512(const uint8_t* const* src, size_t offset)
+		{
+			hash_type_t<512> val = _mm512_castsi128_si512(unaligned_read<128>(src[0] + offset));
+			val = _mm512_inserti32x4(val, unaligned_read<128>(src[1] + offset), 1);
+			val = _mm512_inserti32x4(val, unaligned_read<128>(src[2] + offset), 2);
+			val = _mm512_inserti32x4(val, unaligned_read<128>(src[3] + offset), 3);
+			return val;
+		}
+
+		MEOWH_TARGET_VAES_512 MEOWH_FORCE_STATIC_INLINE hash_type_t<512> set_lanes_512(const uint64_t* lo, const uint64_t* hi)
+		{
+			return _mm512_set_epi64(static_cast<int64_t>(hi[3]), static_cast<int64_t>(lo[3]), static_cast<int64_t>(hi[2]), static_cast<int64_t>(lo[2]),
+				static_cast<int64_t>(hi[1]), static_cast<int64_t>(lo[1]), static_cast<int64_t>(hi[0]), static_cast<int64_t>(lo[0]));
+		}
+#endif
+
 		template <size_t N>
 		MEOWH_FORCE_STATIC_INLINE void aes_merge(hash_t<N>& a, const hash_t<N>& b)
 		{
 			if constexpr (N == 128)
 			{
-				a[0] = _mm_aesdec_si128(a[0], b[0]);
-				a[1] = _mm_aesdec_si128(a[1], b[1]);
-				a[2] = _mm_aesdec_si128(a[2], b[2]);
-				a[3] = _mm_aesdec_si128(a[3], b[3]);
+				a[0] = aesdec_128(a[0], b[0]);
+				a[1] = aesdec_128(a[1], b[1]);
+				a[2] = aesdec_128(a[2], b[2]);
+				a[3] = aesdec_128(a[3], b[3]);
 			}
 			else if constexpr (N == 256)
 			{
-				a[0] = _mm256_aesdec_epi128(a[0], b[0]);
-				a[1] = _mm256_aesdec_epi128(a[1], b[1]);
+				a[0] = aesdec_256(a[0], b[0]);
+				a[1] = aesdec_256(a[1], b[1]);
 			}
 			else if constexpr (N == 512)
 			{
-				a[0] = _mm512_aesdec_epi128(a[0], b[0]);
+				a[0] = aesdec_512(a[0], b[0]);
 			}
 		}
 
@@ -328,21 +500,14 @@ namespace meowh
 				b[2] = b[3];
 				b[3] = tmp;
 			}
-			else
+			else if constexpr (N == 256)
 			{
-				hash_t<128> rot_b = b;
-
-				hash_type_t<128> tmp = rot_b[0];
-				rot_b[0] = rot_b[1];
-				rot_b[1] = rot_b[2];
-				rot_b[2] = rot_b[3];
-				rot_b[3] = tmp;
-
-				b = rot_b;
-
-
+				lane_rotate_256(b[0], b[1]);
+			}
+			else if constexpr (N == 512)
+			{
+				b[0] = lane_rotate_512(b[0]);
 			}
-
 		}
 
 		template <size_t N, bool Align, typename ptr_arg_t = typename std::conditional<Align == true, const hash_type_t<N>*, const uint8_t*>::type>
@@ -352,131 +517,325 @@ namespace meowh
 			{
 				if constexpr (N == 128)
 				{
-					a[0] = _mm_aesdec_si128(a[0], *(src));
-					a[1] = _mm_aesdec_si128(a[1], *(src + 1));
-					a[2] = _mm_aesdec_si128(a[2], *(src + 2));
-					a[3] = _mm_aesdec_si128(a[3], *(src + 3));
+					a[0] = aesdec_128(a[0], *(src));
+					a[1] = aesdec_128(a[1], *(src + 1));
+					a[2] = aesdec_128(a[2], *(src + 2));
+					a[3] = aesdec_128(a[3], *(src + 3));
 				}
 				else if constexpr (N == 256)
 				{
-					a[0] = _mm256_aesdec_epi128(a[0], *(src));
-					a[1] = _mm256_aesdec_epi128(a[1], *(src + 1));
+					a[0] = aesdec_256(a[0], *(src));
+					a[1] = aesdec_256(a[1], *(src + 1));
 				}
 				else if constexpr (N == 512)
 				{
-					a[0] = _mm512_aesdec_epi128(a[0], *(src));
+					a[0] = aesdec_512(a[0], *(src));
 				}
 			}
 			else
 			{
 				if constexpr (N == 128)
 				{
-					a[0] = _mm_aesdec_si128(a[0], unaligned_read<128>(src));
-					a[1] = _mm_aesdec_si128(a[1], unaligned_read<128>(src + 16));
-					a[2] = _mm_aesdec_si128(a[2], unaligned_read<128>(src + 32));
-					a[3] = _mm_aesdec_si128(a[3], unaligned_read<128>(src + 48));
+					a[0] = aesdec_128(a[0], src);
+					a[1] = aesdec_128(a[1], src + 16);
+					a[2] = aesdec_128(a[2], src + 32);
+					a[3] = aesdec_128(a[3], src + 48);
 				}
 				else if constexpr (N == 256)
 				{
-					a[0] = _mm256_aesdec_epi128(a[0], unaligned_read<256>(src));
-					a[1] = _mm256_aesdec_epi128(a[1], unaligned_read<256>(src + 32));
+					a[0] = aesdec_256(a[0], src);
+					a[1] = aesdec_256(a[1], src + 32);
 				}
 				else if constexpr (N == 512)
 				{
-					a[0] = _mm512_aesdec_epi128(a[0], unaligned_read<512>(src));
+					a[0] = aesdec_512(a[0], src);
 				}
 			}
 		}
 
-		template <size_t N, bool Align = false, size_t R = N>
-		static hash_t<R> meow_hash_impl(const uint8_t* src, uint64_t len, uint64_t seed)
+		// Absorbs a single 128, 256, or 512 bit chunk into a single lane of a stream.
+		template <size_t N, bool Align>
+		MEOWH_FORCE_STATIC_INLINE hash_type_t<N> aes_load_lane(hash_type_t<N> a, const uint8_t* src)
+		{
+			if constexpr (Align)
+			{
+				const hash_type_t<N>* aligned_src = reinterpret_cast<const hash_type_t<N>*>(src);
+
+				if constexpr (N == 128)
+				{
+					return aesdec_128(a, *aligned_src);
+				}
+				else if constexpr (N == 256)
+				{
+					return aesdec_256(a, *aligned_src);
+				}
+				else if constexpr (N == 512)
+				{
+					return aesdec_512(a, *aligned_src);
+				}
+			}
+			else
+			{
+				if constexpr (N == 128)
+				{
+					return aesdec_128(a, src);
+				}
+				else if constexpr (N == 256)
+				{
+					return aesdec_256(a, src);
+				}
+				else if constexpr (N == 512)
+				{
+					return aesdec_512(a, src);
+				}
+			}
+		}
+
+		MEOWH_FORCE_STATIC_INLINE hash_t<64> make_init_vector(uint64_t seed, uint64_t len)
 		{
 			hash_t<64> init_vector;
 
 			init_vector[0] = init_vector[2] = init_vector[4] = init_vector[6] = seed;
 			init_vector[1] = init_vector[3] = init_vector[5] = init_vector[7] = seed + len + 1;
 
-			hash_t<N> stream_0123 = init_vector;
-			hash_t<N> stream_4567 = init_vector;
-			hash_t<N> stream_89AB = init_vector;
-			hash_t<N> stream_CDEF = init_vector;
+			return init_vector;
+		}
 
-			uint64_t block_count = len / 256;
-			len -= block_count * 256;
+		// The sixteen hash streams, grouped by the 64 byte cache line of each 256 byte block they absorb.
+		template <size_t N>
+		struct meow_streams
+		{
+			hash_t<N> stream_0123;
+			hash_t<N> stream_4567;
+			hash_t<N> stream_89AB;
+			hash_t<N> stream_CDEF;
 
-			if constexpr (Align == true)
+			meow_streams() {};
+
+			explicit meow_streams(const hash_t<64>& init_vector)
 			{
-				const hash_type_t<N>* aligned_src = reinterpret_cast<const hash_type_t<N>*>(src);
+				hash_t<N> init = init_vector;
+				stream_0123 = stream_4567 = stream_89AB = stream_CDEF = init;
+			}
+		};
 
+		template <size_t N, bool Align, typename ptr_arg_t = typename std::conditional<Align == true, const hash_type_t<N>*, const uint8_t*>::type>
+		MEOWH_FORCE_STATIC_INLINE void absorb_block(meow_streams<N>& streams, ptr_arg_t src)
+		{
+			if constexpr (Align == true)
+			{
 				constexpr int32_t size_div = sizeof(hash_type_t<N>);
 
-				while (block_count-- > 0)
-				{
-					aes_load<N, true>(stream_0123, aligned_src);
-					aes_load<N, true>(stream_4567, aligned_src + (64 / size_div));
-					aes_load<N, true>(stream_89AB, aligned_src + (128 / size_div));
-					aes_load<N, true>(stream_CDEF, aligned_src + (192 / size_div));
+				aes_load<N, true>(streams.stream_0123, src);
+				aes_load<N, true>(streams.stream_4567, src + (64 / size_div));
+				aes_load<N, true>(streams.stream_89AB, src + (128 / size_div));
+				aes_load<N, true>(streams.stream_CDEF, src + (192 / size_div));
+			}
+			else
+			{
+				aes_load<N, false>(streams.stream_0123, src);
+				aes_load<N, false>(streams.stream_4567, src + 64);
+				aes_load<N, false>(streams.stream_89AB, src + 128);
+				aes_load<N, false>(streams.stream_CDEF, src + 192);
+			}
+		}
 
-					aligned_src += (256 / size_div);
-				}
+		template <size_t Lane>
+		MEOWH_FORCE_STATIC_INLINE hash_type_t<128>& stream_lane(meow_streams<128>& streams)
+		{
+			if constexpr (Lane / 4 == 0)
+			{
+				return streams.stream_0123[Lane % 4];
+			}
+			else if constexpr (Lane / 4 == 1)
+			{
+				return streams.stream_4567[Lane % 4];
+			}
+			else if constexpr (Lane / 4 == 2)
+			{
+				return streams.stream_89AB[Lane % 4];
+			}
+			else
+			{
+				return streams.stream_CDEF[Lane % 4];
+			}
+		}
 
-				if (len > 0)
-				{
-					std::array<hash_t<N>, 4> partial = { init_vector, init_vector, init_vector, init_vector };
-					std::memcpy(reinterpret_cast<void*>(partial.data()), reinterpret_cast<const void*>(aligned_src), static_cast<size_t>(len));
+		/* Builds a 16 byte lane out of the first rem < 16 bytes at src, followed by the bytes of the initialization vector lane,
+		 * in general purpose registers. Unlike copying the bytes over a copy of the initialization vector in memory and loading it back,
+		 * this doesn't stall on store forwarding, and it never reads past src + rem. */
+		MEOWH_FORCE_STATIC_INLINE hash_type_t<128> load_partial_lane(const uint8_t* src, size_t rem, uint64_t iv_lo, uint64_t iv_hi)
+		{
+			uint64_t lo = 0;
+			uint64_t hi = 0;
+			uint32_t lo_32 = 0;
+			uint32_t hi_32 = 0;
 
-					aes_merge<N>(stream_0123, partial[0]);
-					aes_merge<N>(stream_4567, partial[1]);
-					aes_merge<N>(stream_89AB, partial[2]);
-					aes_merge<N>(stream_CDEF, partial[3]);
+			if (rem > 8)
+			{
+				std::memcpy(&lo, src, 8);
+				std::memcpy(&hi, src + rem - 8, 8);
+				hi >>= 8 * (16 - rem);
+				hi |= iv_hi & ~((uint64_t(1) << (8 * (rem - 8))) - 1);
+			}
+			else if (rem == 8)
+			{
+				std::memcpy(&lo, src, 8);
+				hi = iv_hi;
+			}
+			else
+			{
+				if (rem >= 4)
+				{
+					std::memcpy(&lo_32, src, 4);
+					std::memcpy(&hi_32, src + rem - 4, 4);
+					lo = lo_32 | (static_cast<uint64_t>(hi_32) << (8 * (rem - 4)));
 				}
+				else if (rem > 0)
+				{
+					lo = src[0] | (static_cast<uint64_t>(src[rem / 2]) << (8 * (rem / 2))) | (static_cast<uint64_t>(src[rem - 1]) << (8 * (rem - 1)));
+				}
+
+				lo |= iv_lo & ~((uint64_t(1) << (8 * rem)) - 1);
+				hi = iv_hi;
+			}
 
+			return _mm_set_epi64x(static_cast<int64_t>(hi), static_cast<int64_t>(lo));
+		}
+
+		template <size_t Lane>
+		MEOWH_FORCE_STATIC_INLINE void absorb_partial_lane(meow_streams<128>& streams, const hash_t<64>& init_vector, const uint8_t* src, size_t len)
+		{
+			hash_type_t<128>& stream = stream_lane<Lane>(streams);
+
+			if (Lane < len / 16)
+			{
+				stream = aesdec_128(stream, src + Lane * 16);
+			}
+			else if (Lane == len / 16)
+			{
+				stream = aesdec_128(stream, load_partial_lane(src + Lane * 16, len % 16, init_vector[0], init_vector[1]));
 			}
 			else
 			{
-				while (block_count-- > 0)
+				stream = aesdec_128(stream, init_vector.template as<128>(0));
+			}
+		}
+
+		template <size_t... Lanes>
+		MEOWH_FORCE_STATIC_INLINE void absorb_partial_lanes(meow_streams<128>& streams, const hash_t<64>& init_vector, const uint8_t* src, size_t len, std::index_sequence<Lanes...>)
+		{
+			(absorb_partial_lane<Lanes>(streams, init_vector, src, len), ...);
+		}
+
+		// Hashes the final, shorter than 256 bytes, block padded with the initialization vector.
+		template <size_t N>
+		MEOWH_FORCE_STATIC_INLINE void absorb_partial(meow_streams<N>& streams, const hash_t<64>& init_vector, const void* src, size_t len)
+		{
+			if constexpr (N == 128)
+			{
+				absorb_partial_lanes(streams, init_vector, reinterpret_cast<const uint8_t*>(src), len, std::make_index_sequence<16>());
+			}
+			else
+			{
+				std::array<hash_t<N>, 4> partial = { init_vector, init_vector, init_vector, init_vector };
+				std::memcpy(reinterpret_cast<void*>(partial.data()), src, len);
+
+				aes_merge<N>(streams.stream_0123, partial[0]);
+				aes_merge<N>(streams.stream_4567, partial[1]);
+				aes_merge<N>(streams.stream_89AB, partial[2]);
+				aes_merge<N>(streams.stream_CDEF, partial[3]);
+			}
+		}
+
+		/* Inputs shorter than 256 bytes are just the partial block absorbed into streams that all still hold the initialization vector,
+		 * so every lane past the end of the input ends up with the same aesdec(iv, iv) value, computed only once.
+		 * L is the number of lanes that can hold input bytes, so that each size class gets its own fully unrolled code.
+		 * MeowHash1, 2 and 4 are equivalent, so this is done 128 bits wide for all of them. */
+		template <size_t L, size_t Lane>
+		MEOWH_FORCE_STATIC_INLINE void absorb_short_lane(meow_streams<128>& streams, const hash_t<64>& init_vector, hash_type_t<128> iv_only, const uint8_t* src, size_t len)
+		{
+			hash_type_t<128>& stream = stream_lane<Lane>(streams);
+
+			if constexpr (Lane < L)
+			{
+				if (Lane < len / 16)
 				{
-					aes_load<N, false>(stream_0123, src);
-					aes_load<N, false>(stream_4567, src + 64);
-					aes_load<N, false>(stream_89AB, src + 128);
-					aes_load<N, false>(stream_CDEF, src + 192);
-					src += 256;
+					stream = aesdec_128(stream, src + Lane * 16);
+					return;
 				}
-
-				if (len > 0)
+				else if (Lane == len / 16 && len % 16 > 0)
 				{
-					std::array<hash_t<N>, 4> partial = { init_vector, init_vector, init_vector, init_vector };
-					std::memcpy(reinterpret_cast<void*>(partial.data()), src, static_cast<size_t>(len));
-
-					aes_merge<N>(stream_0123, partial[0]);
-					aes_merge<N>(stream_4567, partial[1]);
-					aes_merge<N>(stream_89AB, partial[2]);
-					aes_merge<N>(stream_CDEF, partial[3]);
+					stream = aesdec_128(stream, load_partial_lane(src + Lane * 16, len % 16, init_vector[0], init_vector[1]));
+					return;
 				}
 			}
 
+			stream = iv_only;
+		}
+
+		template <size_t L, size_t... Lanes>
+		MEOWH_FORCE_STATIC_INLINE void absorb_short_lanes(meow_streams<128>& streams, const hash_t<64>& init_vector, const uint8_t* src, size_t len, std::index_sequence<Lanes...>)
+		{
+			hash_type_t<128> iv = init_vector.template as<128>(0);
+			hash_type_t<128> iv_only = aesdec_128(iv, iv);
+
+			(absorb_short_lane<L, Lanes>(streams, init_vector, iv_only, src, len), ...);
+		}
+
+		// Absorbs an entire input shorter than 256 bytes into freshly initialized streams.
+		MEOWH_FORCE_STATIC_INLINE void absorb_short(meow_streams<128>& streams, const hash_t<64>& init_vector, const uint8_t* src, size_t len)
+		{
+			if (len == 0)
+			{
+				return;
+			}
+			else if (len <= 16)
+			{
+				absorb_short_lanes<1>(streams, init_vector, src, len, std::make_index_sequence<16>());
+			}
+			else if (len <= 32)
+			{
+				absorb_short_lanes<2>(streams, init_vector, src, len, std::make_index_sequence<16>());
+			}
+			else if (len <= 64)
+			{
+				absorb_short_lanes<4>(streams, init_vector, src, len, std::make_index_sequence<16>());
+			}
+			else if (len <= 128)
+			{
+				absorb_short_lanes<8>(streams, init_vector, src, len, std::make_index_sequence<16>());
+			}
+			else
+			{
+				absorb_short_lanes<16>(streams, init_vector, src, len, std::make_index_sequence<16>());
+			}
+		}
 
+		template <size_t N, size_t R = N>
+		MEOWH_FORCE_STATIC_INLINE hash_t<R> finalize(meow_streams<N>& streams, const hash_t<64>& init_vector)
+		{
 			hash_t<N> ret = init_vector;
 
-			aes_rotate<N>(ret, stream_0123);
-			aes_rotate<N>(ret, stream_4567);
-			aes_rotate<N>(ret, stream_89AB);
-			aes_rotate<N>(ret, stream_CDEF);
+			aes_rotate<N>(ret, streams.stream_0123);
+			aes_rotate<N>(ret, streams.stream_4567);
+			aes_rotate<N>(ret, streams.stream_89AB);
+			aes_rotate<N>(ret, streams.stream_CDEF);
 
-			aes_rotate<N>(ret, stream_0123);
-			aes_rotate<N>(ret, stream_4567);
-			aes_rotate<N>(ret, stream_89AB);
-			aes_rotate<N>(ret, stream_CDEF);
+			aes_rotate<N>(ret, streams.stream_0123);
+			aes_rotate<N>(ret, streams.stream_4567);
+			aes_rotate<N>(ret, streams.stream_89AB);
+			aes_rotate<N>(ret, streams.stream_CDEF);
 
-			aes_rotate<N>(ret, stream_0123);
-			aes_rotate<N>(ret, stream_4567);
-			aes_rotate<N>(ret, stream_89AB);
-			aes_rotate<N>(ret, stream_CDEF);
+			aes_rotate<N>(ret, streams.stream_0123);
+			aes_rotate<N>(ret, streams.stream_4567);
+			aes_rotate<N>(ret, streams.stream_89AB);
+			aes_rotate<N>(ret, streams.stream_CDEF);
 
-			aes_rotate<N>(ret, stream_0123);
-			aes_rotate<N>(ret, stream_4567);
-			aes_rotate<N>(ret, stream_89AB);
-			aes_rotate<N>(ret, stream_CDEF);
+			aes_rotate<N>(ret, streams.stream_0123);
+			aes_rotate<N>(ret, streams.stream_4567);
+			aes_rotate<N>(ret, streams.stream_89AB);
+			aes_rotate<N>(ret, streams.stream_CDEF);
 
 			aes_merge<N>(ret, init_vector);
 			aes_merge<N>(ret, init_vector);
@@ -486,52 +845,1797 @@ namespace meowh
 
 			return ret;
 		}
-	}
 
-	template <size_t N, bool Align = false, size_t R = N>
-	hash_t<R> meow_hash(const void* input, size_t len, uint64_t seed = 0)
-	{
-		static_assert(N == 128 || N == 256 || N == 512, "meow_hash can only be called in 128, 256, or 512 bit mode.");
-		return detail::meow_hash_impl<N, Align, R>(reinterpret_cast<const uint8_t*>(input), len, seed);
-	}
+		// Absorbs block_count blocks of zeros, with the zeros kept in a register.
+		template <size_t N>
+		MEOWH_FORCE_STATIC_INLINE void absorb_zero_blocks(meow_streams<N>& streams, uint64_t block_count)
+		{
+			hash_t<64> zero_bytes;
+			zero_bytes.elem.fill(0);
+			hash_t<N> zero = zero_bytes;
 
-	template <size_t N, bool Align = false, size_t R = N, typename T, size_t AN>
-	hash_t<R> meow_hash(const std::array<T, AN>& input, uint64_t seed = 0)
-	{
-		static_assert(N == 128 || N == 256 || N == 512, "meow_hash can only be called in 128, 256, or 512 bit mode.");
-		return detail::meow_hash_impl<N, Align, R>(reinterpret_cast<const uint8_t*>(input.data()), input.size() * sizeof(T), seed);
-	}
+			while (block_count-- > 0)
+			{
+				aes_merge<N>(streams.stream_0123, zero);
+				aes_merge<N>(streams.stream_4567, zero);
+				aes_merge<N>(streams.stream_89AB, zero);
+				aes_merge<N>(streams.stream_CDEF, zero);
+			}
+		}
 
-	template <size_t N, bool Align = false, size_t R = N, typename T>
-	hash_t<R> meow_hash(const std::basic_string<T>& input, uint64_t seed = 0)
-	{
-		static_assert(N == 128 || N == 256 || N == 512, "meow_hash can only be called in 128, 256, or 512 bit mode.");
-		return detail::meow_hash_impl<N, Align, R>(reinterpret_cast<const uint8_t*>(input.data()), input.length() * sizeof(T), seed);
-	}
+		template <size_t N, bool Align>
+		MEOWH_FORCE_STATIC_INLINE void absorb_input(meow_streams<N>& streams, const hash_t<64>& init_vector, const uint8_t* src, uint64_t len)
+		{
+			uint64_t block_count = len / 256;
+			len -= block_count * 256;
 
-	template <size_t N, bool Align = false, size_t R = N, typename T>
-	hash_t<R> meow_hash(const std::vector<T>& input, uint64_t seed = 0)
-	{
-		static_assert(N == 128 || N == 256 || N == 512, "meow_hash can only be called in 128, 256, or 512 bit mode.");
-		return detail::meow_hash_impl<N, Align, R>(reinterpret_cast<const uint8_t*>(input.data()), input.size() * sizeof(T), seed);
-	}
+			if constexpr (Align == true)
+			{
+				const hash_type_t<N>* aligned_src = reinterpret_cast<const hash_type_t<N>*>(src);
 
-	template <size_t N, bool Align = false, size_t R = N, typename T>
-	hash_t<R> meow_hash(const std::initializer_list<T>& input, uint64_t seed = 0)
-	{
-		static_assert(N == 128 || N == 256 || N == 512, "meow_hash can only be called in 128, 256, or 512 bit mode.");
-		return detail::meow_hash_impl<N, Align, R>(reinterpret_cast<const uint8_t*>(input.begin()), input.size() * sizeof(T), seed);
-	}
+				constexpr int32_t size_div = sizeof(hash_type_t<N>);
+
+				while (block_count-- > 0)
+				{
+					absorb_block<N, true>(streams, aligned_src);
+					aligned_src += (256 / size_div);
+				}
+
+				if (len > 0)
+				{
+					absorb_partial<N>(streams, init_vector, aligned_src, static_cast<size_t>(len));
+				}
+
+			}
+			else
+			{
+				while (block_count-- > 0)
+				{
+					absorb_block<N, false>(streams, src);
+					src += 256;
+				}
+
+				if (len > 0)
+				{
+					absorb_partial<N>(streams, init_vector, src, static_cast<size_t>(len));
+				}
+			}
+		}
+
+		/* absorb_input with a software prefetch of the cache lines Distance bytes ahead of the block being absorbed.
+		 * The prefetches stop Distance bytes before the end, so that they never touch memory past the input. */
+		template <bool NonTemporal>
+		MEOWH_FORCE_STATIC_INLINE void prefetch_block(const uint8_t* src)
+		{
+			for (size_t line = 0; line < 256; line += 64)
+			{
+				if constexpr (NonTemporal)
+				{
+					_mm_prefetch(reinterpret_cast<const char*>(src + line), _MM_HINT_NTA);
+				}
+				else
+				{
+					_mm_prefetch(reinterpret_cast<const char*>(src + line), _MM_HINT_T0);
+				}
+			}
+		}
+
+		template <size_t N, bool Align, bool NonTemporal, size_t Distance>
+		MEOWH_FORCE_STATIC_INLINE void absorb_input_prefetch(meow_streams<N>& streams, const hash_t<64>& init_vector, const uint8_t* src, uint64_t len)
+		{
+			static_assert(Distance % 256 == 0, "The prefetch distance has to be a multiple of the 256 byte block size.");
+
+			uint64_t block_count = len / 256;
+			uint64_t prefetch_count = block_count > Distance / 256 ? block_count - Distance / 256 : 0;
+
+			for (uint64_t block = 0; block < prefetch_count; block++)
+			{
+				prefetch_block<NonTemporal>(src + Distance);
+
+				if constexpr (Align == true)
+				{
+					absorb_block<N, true>(streams, reinterpret_cast<const hash_type_t<N>*>(src));
+				}
+				else
+				{
+					absorb_block<N, false>(streams, src);
+				}
+				src += 256;
+			}
+
+			absorb_input<N, Align>(streams, init_vector, src, len - prefetch_count * 256);
+		}
+
+		// Computes only the first 128 bit lane of the finalization, which is all that the 32, 64 and 128 bit truncations of the hash depend on.
+		// After r rotations, lane 0 of the stream holding lanes 4s to 4s + 3 holds the original lane 4s + r.
+		template <size_t N>
+		MEOWH_FORCE_STATIC_INLINE hash_type_t<128> finalize_lane_0(const meow_streams<N>& streams, const hash_t<64>& init_vector)
+		{
+			static_assert(sizeof(streams) == 256, "meow_streams is expected to hold the sixteen streams back to back.");
+
+			hash_type_t<128> lanes[16];
+			std::memcpy(reinterpret_cast<void*>(lanes), reinterpret_cast<const void*>(&streams), sizeof(streams));
+
+			hash_type_t<128> iv = init_vector.template as<128>(0);
+			hash_type_t<128> ret = iv;
+
+			for (size_t r = 0; r < 4; r++)
+			{
+				ret = aesdec_128(ret, lanes[r]);
+				ret = aesdec_128(ret, lanes[4 + r]);
+				ret = aesdec_128(ret, lanes[8 + r]);
+				ret = aesdec_128(ret, lanes[12 + r]);
+			}
+
+			ret = aesdec_128(ret, iv);
+			ret = aesdec_128(ret, iv);
+			ret = aesdec_128(ret, iv);
+			ret = aesdec_128(ret, iv);
+			ret = aesdec_128(ret, iv);
+
+			return ret;
+		}
+
+		template <size_t N, bool Align = false, size_t R = N>
+		static hash_t<R> meow_hash_impl(const uint8_t* src, uint64_t len, uint64_t seed)
+		{
+			hash_t<64> init_vector = make_init_vector(seed, len);
+
+			if (len < 256)
+			{
+				meow_streams<128> short_streams(init_vector);
+				absorb_short(short_streams, init_vector, src, static_cast<size_t>(len));
+				return finalize<128, R>(short_streams, init_vector);
+			}
+
+			meow_streams<N> streams(init_vector);
+
+			absorb_input<N, Align>(streams, init_vector, src, len);
+
+			return finalize<N, R>(streams, init_vector);
+		}
+
+		// Inputs of up to this many full blocks have their block loop unrolled entirely by meow_hash_fixed_impl.
+		constexpr uint64_t fixed_unroll_block_limit = 16;
+
+		template <size_t N, bool Align, size_t... Blocks>
+		MEOWH_FORCE_STATIC_INLINE void absorb_blocks_unrolled(meow_streams<N>& streams, const uint8_t* src, std::index_sequence<Blocks...>)
+		{
+			if constexpr (Align == true)
+			{
+				(absorb_block<N, true>(streams, reinterpret_cast<const hash_type_t<N>*>(src + Blocks * 256)), ...);
+			}
+			else
+			{
+				(absorb_block<N, false>(streams, src + Blocks * 256), ...);
+			}
+		}
+
+		// meow_hash_impl for a length known at compile time, with the size class, block count and the presence of a partial block all resolved statically.
+		template <size_t N, uint64_t Len, bool Align = false, size_t R = N>
+		static hash_t<R> meow_hash_fixed_impl(const uint8_t* src, uint64_t seed)
+		{
+			hash_t<64> init_vector = make_init_vector(seed, Len);
+
+			if constexpr (Len < 256)
+			{
+				meow_streams<128> short_streams(init_vector);
+				absorb_short(short_streams, init_vector, src, static_cast<size_t>(Len));
+				return finalize<128, R>(short_streams, init_vector);
+			}
+			else
+			{
+				meow_streams<N> streams(init_vector);
+
+				constexpr uint64_t block_count = Len / 256;
+
+				if constexpr (block_count <= fixed_unroll_block_limit)
+				{
+					absorb_blocks_unrolled<N, Align>(streams, src, std::make_index_sequence<static_cast<size_t>(block_count)>());
+					src += block_count * 256;
+				}
+				else if constexpr (Align == true)
+				{
+					for (uint64_t block = 0; block < block_count; block++)
+					{
+						absorb_block<N, true>(streams, reinterpret_cast<const hash_type_t<N>*>(src));
+						src += 256;
+					}
+				}
+				else
+				{
+					for (uint64_t block = 0; block < block_count; block++)
+					{
+						absorb_block<N, false>(streams, src);
+						src += 256;
+					}
+				}
+
+				if constexpr (Len % 256 > 0)
+				{
+					absorb_partial<N>(streams, init_vector, src, static_cast<size_t>(Len % 256));
+				}
+
+				return finalize<N, R>(streams, init_vector);
+			}
+		}
+	}
+
+	template <size_t N, bool Align = false, size_t R = N>
+	hash_t<R> meow_hash(const void* input, size_t len, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash can only be called in 128, 256, or 512 bit mode.");
+		return detail::meow_hash_impl<N, Align, R>(reinterpret_cast<const uint8_t*>(input), len, seed);
+	}
+
+	template <size_t N, bool Align = false, size_t R = N, typename T, size_t AN>
+	hash_t<R> meow_hash(const std::array<T, AN>& input, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash can only be called in 128, 256, or 512 bit mode.");
+		return detail::meow_hash_fixed_impl<N, AN * sizeof(T), Align, R>(reinterpret_cast<const uint8_t*>(input.data()), seed);
+	}
+
+	// meow_hash for inputs of a length known at compile time, such as fixed size structs or pages.
+	template <size_t N, size_t Len, bool Align = false, size_t R = N>
+	hash_t<R> meow_hash_fixed(const void* input, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash_fixed can only be called in 128, 256, or 512 bit mode.");
+		return detail::meow_hash_fixed_impl<N, Len, Align, R>(reinterpret_cast<const uint8_t*>(input), seed);
+	}
+
+	enum class meow_prefetch
+	{
+		// Prefetches into all levels of the cache, for input that is read again soon after hashing.
+		temporal,
+		// Prefetches with PREFETCHNTA, which keeps cold input from evicting the rest of the cache.
+		non_temporal
+	};
+
+	constexpr size_t meow_prefetch_distance = 2048;
+
+	// meow_hash with software prefetching Distance bytes ahead, for input much larger than the last level cache, which isn't in the cache yet.
+	// The results are the same as meow_hash<N, Align, R>.
+	template <size_t N, meow_prefetch Hint = meow_prefetch::temporal, size_t Distance = meow_prefetch_distance, bool Align = false, size_t R = N>
+	hash_t<R> meow_hash_prefetch(const void* input, size_t len, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash_prefetch can only be called in 128, 256, or 512 bit mode.");
+
+		const uint8_t* src = reinterpret_cast<const uint8_t*>(input);
+
+		if (len < 256)
+		{
+			return detail::meow_hash_impl<N, Align, R>(src, len, seed);
+		}
 
-	template <size_t N, bool Align = false, size_t R = N, typename ContiguousIterator>
-	hash_t<R> meow_hash(ContiguousIterator begin, ContiguousIterator end, uint64_t seed = 0)
+		hash_t<64> init_vector = detail::make_init_vector(seed, len);
+		detail::meow_streams<N> streams(init_vector);
+
+		detail::absorb_input_prefetch<N, Align, Hint == meow_prefetch::non_temporal, Distance>(streams, init_vector, src, len);
+
+		return detail::finalize<N, R>(streams, init_vector);
+	}
+
+	template <size_t N, bool Align = false, size_t R = N, typename T>
+	hash_t<R> meow_hash(const std::basic_string<T>& input, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash can only be called in 128, 256, or 512 bit mode.");
+		return detail::meow_hash_impl<N, Align, R>(reinterpret_cast<const uint8_t*>(input.data()), input.length() * sizeof(T), seed);
+	}
+
+	template <size_t N, bool Align = false, size_t R = N, typename T>
+	hash_t<R> meow_hash(const std::vector<T>& input, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash can only be called in 128, 256, or 512 bit mode.");
+		return detail::meow_hash_impl<N, Align, R>(reinterpret_cast<const uint8_t*>(input.data()), input.size() * sizeof(T), seed);
+	}
+
+	template <size_t N, bool Align = false, size_t R = N, typename T>
+	hash_t<R> meow_hash(const std::initializer_list<T>& input, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash can only be called in 128, 256, or 512 bit mode.");
+		return detail::meow_hash_impl<N, Align, R>(reinterpret_cast<const uint8_t*>(input.begin()), input.size() * sizeof(T), seed);
+	}
+
+	template <size_t N, size_t R = N>
+	class meow_state;
+
+	namespace detail
+	{
+		template <typename T>
+		constexpr bool is_char_type = std::is_same<T, char>::value || std::is_same<T, wchar_t>::value || std::is_same<T, char16_t>::value || std::is_same<T, char32_t>::value;
+
+		// Whether the elements between two iterators are known to be stored next to each other, at compile time.
+		template <typename Iterator>
+		constexpr bool is_contiguous_iterator()
+		{
+#ifdef __cpp_lib_concepts
+			return std::contiguous_iterator<Iterator>;
+#else
+			using T = std::remove_cv_t<typename std::iterator_traits<Iterator>::value_type>;
+
+			if constexpr (std::is_pointer<Iterator>::value)
+			{
+				return true;
+			}
+			else if constexpr (!std::is_object<T>::value || std::is_array<T>::value || std::is_same<T, bool>::value)
+			{
+				return false;
+			}
+			else if constexpr (is_char_type<T>)
+			{
+				return std::is_same<Iterator, typename std::vector<T>::iterator>::value || std::is_same<Iterator, typename std::vector<T>::const_iterator>::value ||
+					std::is_same<Iterator, typename std::basic_string<T>::iterator>::value || std::is_same<Iterator, typename std::basic_string<T>::const_iterator>::value ||
+					std::is_same<Iterator, typename std::basic_string_view<T>::const_iterator>::value;
+			}
+			else
+			{
+				return std::is_same<Iterator, typename std::vector<T>::iterator>::value || std::is_same<Iterator, typename std::vector<T>::const_iterator>::value;
+			}
+#endif
+		}
+
+		// The number of elements in each block of a std::deque<T>, taken from the standard library, or 0 if it isn't known, like in libstdc++'s debug mode.
+		template <typename T>
+		constexpr size_t deque_block_size()
+		{
+#if defined(__GLIBCXX__) && !defined(_GLIBCXX_DEBUG)
+			return std::__deque_buf_size(sizeof(T));
+#elif defined(_LIBCPP_VERSION)
+			return static_cast<size_t>(std::__deque_block_size<T, std::ptrdiff_t>::value);
+#else
+			return 0;
+#endif
+		}
+
+		template <typename Iterator, typename T>
+		constexpr bool is_deque_iterator = std::is_same<Iterator, typename std::deque<T>::iterator>::value || std::is_same<Iterator, typename std::deque<T>::const_iterator>::value;
+
+		/* The number of elements from it on, at most max_len, that are stored next to each other, for the iterators of a std::deque with blocks of block_size elements.
+		 * Two elements at most a block apart are in the same block or in neighbouring ones, so if their addresses are as far apart as their positions,
+		 * so are those of all the elements between them. The run is extended a block at a time, and its end within the last block is found by bisection. */
+		template <typename Iterator, typename T>
+		size_t deque_run_length(Iterator it, const T* run, size_t max_len, size_t block_size)
+		{
+			size_t run_len = 1;
+
+			while (run_len < max_len)
+			{
+				size_t step = std::min(block_size, max_len - run_len);
+
+				if (std::addressof(it[run_len + step - 1]) == run + run_len + step - 1)
+				{
+					run_len += step;
+					continue;
+				}
+
+				// The element at run_len - 1 is in the run and the one at run_len + step - 1 isn't.
+				size_t last_in = run_len - 1;
+				size_t first_out = run_len + step - 1;
+
+				while (first_out - last_in > 1)
+				{
+					size_t middle = last_in + (first_out - last_in) / 2;
+
+					if (std::addressof(it[middle]) == run + middle)
+					{
+						last_in = middle;
+					}
+					else
+					{
+						first_out = middle;
+					}
+				}
+
+				return first_out;
+			}
+
+			return run_len;
+		}
+
+		/* Hashes the elements between two iterators that aren't known to be contiguous, like those of std::deque and std::list, without copying them all into a buffer.
+		 * Runs of elements that turn out to be stored next to each other, like the blocks of a std::deque, are hashed in place, shorter ones are gathered into a
+		 * 256 byte staging buffer, and so are elements that the iterators return by value, like those of ropes and std::vector<bool>.
+		 * The runs of other iterators are found by checking the address of every element, except for those of std::deque, which are found a block at a time. */
+		template <size_t N, size_t R, typename ForwardIterator>
+		hash_t<R> meow_hash_range_impl(ForwardIterator begin, ForwardIterator end, uint64_t seed)
+		{
+			using T = std::remove_cv_t<typename std::iterator_traits<ForwardIterator>::value_type>;
+
+			static_assert(std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<ForwardIterator>::iterator_category>::value,
+				"meow_hash needs forward iterators, since the length of the input is needed before hashing it.");
+			static_assert(std::is_trivially_copyable<T>::value, "meow_hash can only hash ranges of trivially copyable elements.");
+
+			meow_state<N, R> state(static_cast<uint64_t>(std::distance(begin, end)) * sizeof(T), seed);
+
+			alignas(64) std::array<uint8_t, 256> staging;
+			size_t staged = 0;
+
+			for (ForwardIterator it = begin; it != end;)
+			{
+				if constexpr (std::is_lvalue_reference<typename std::iterator_traits<ForwardIterator>::reference>::value)
+				{
+					const T* run = std::addressof(*it);
+					size_t run_len = 1;
+
+					if constexpr (is_deque_iterator<ForwardIterator, T> && deque_block_size<T>() > 0)
+					{
+						run_len = deque_run_length(it, run, static_cast<size_t>(end - it), deque_block_size<T>());
+						it += static_cast<std::ptrdiff_t>(run_len);
+					}
+					else
+					{
+						for (++it; it != end && std::addressof(*it) == run + run_len; ++it)
+						{
+							run_len++;
+						}
+					}
+
+					size_t run_bytes = run_len * sizeof(T);
+
+					if (staged + run_bytes <= staging.size())
+					{
+						std::memcpy(staging.data() + staged, run, run_bytes);
+						staged += run_bytes;
+					}
+					else
+					{
+						state.absorb(staging.data(), staged);
+						state.absorb(run, run_bytes);
+						staged = 0;
+					}
+				}
+				else
+				{
+					if (staged + sizeof(T) > staging.size())
+					{
+						state.absorb(staging.data(), staged);
+						staged = 0;
+					}
+
+					T value = *it;
+					std::memcpy(staging.data() + staged, &value, sizeof(T));
+					staged += sizeof(T);
+					++it;
+				}
+			}
+
+			state.absorb(staging.data(), staged);
+
+			return state.finalize();
+		}
+	}
+
+	// Hashes the elements between two forward iterators. Contiguous iterators are hashed like a single buffer, and everything else by detail::meow_hash_range_impl.
+	template <size_t N, bool Align = false, size_t R = N, typename Iterator>
+	hash_t<R> meow_hash(Iterator begin, Iterator end, uint64_t seed = 0)
 	{
 		static_assert(N == 128 || N == 256 || N == 512, "meow_hash can only be called in 128, 256, or 512 bit mode.");
-		using T = std::decay_t<decltype(*end)>;
-		return detail::meow_hash_impl<N, Align, R>(reinterpret_cast<const uint8_t*>(&*begin), (end - begin) * sizeof(T), seed);
+
+		if constexpr (detail::is_contiguous_iterator<Iterator>())
+		{
+			using T = std::decay_t<decltype(*end)>;
+			return detail::meow_hash_impl<N, Align, R>(reinterpret_cast<const uint8_t*>(begin == end ? nullptr : &*begin), (end - begin) * sizeof(T), seed);
+		}
+		else
+		{
+			return detail::meow_hash_range_impl<N, R>(begin, end, seed);
+		}
+	}
+
+	// Hashes the elements of any range with forward iterators, like std::deque or std::list, giving the same result as meow_hash over a copy of them in a single buffer.
+	template <size_t N, size_t R = N, typename Range>
+	hash_t<R> meow_hash_range(const Range& range, uint64_t seed = 0)
+	{
+		return meow_hash<N, false, R>(std::begin(range), std::end(range), seed);
 	}
 
 
+	// Computes only the first B bits of the hash, for B of 32, 64 or 128, skipping three quarters of the finalization.
+	// The result is identical to meow_hash<N, Align>(input, len, seed).as<B>(0), but is returned directly instead of in a 64 byte hash_t.
+	template <size_t N, size_t B, bool Align = false>
+	hash_type_t<B> meow_hash_trunc(const void* input, size_t len, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash_trunc can only be called in 128, 256, or 512 bit mode.");
+		static_assert(B == 32 || B == 64 || B == 128, "meow_hash_trunc can only return the first 32, 64, or 128 bits of the hash.");
+
+		hash_t<64> init_vector = detail::make_init_vector(seed, len);
+		hash_type_t<128> lane;
+
+		if (len < 256)
+		{
+			detail::meow_streams<128> streams(init_vector);
+			detail::absorb_short(streams, init_vector, reinterpret_cast<const uint8_t*>(input), len);
+			lane = detail::finalize_lane_0<128>(streams, init_vector);
+		}
+		else
+		{
+			detail::meow_streams<N> streams(init_vector);
+			detail::absorb_input<N, Align>(streams, init_vector, reinterpret_cast<const uint8_t*>(input), len);
+			lane = detail::finalize_lane_0<N>(streams, init_vector);
+		}
+
+		if constexpr (B == 128)
+		{
+			return lane;
+		}
+		else
+		{
+			hash_type_t<B> ret;
+			std::memcpy(&ret, &lane, sizeof(ret));
+			return ret;
+		}
+	}
+
 	constexpr int32_t meow_hash_version = 1;
 	constexpr const char meow_hash_version_name[] = "0.1 Alpha - clean cpp edition";
-}
\ No newline at end of file
+
+	// meow_tree_hash gives different results than meow_hash, so its format is versioned separately.
+	constexpr int32_t meow_tree_hash_version = 1;
+	constexpr const char meow_tree_hash_version_name[] = "MeowTree 1 - 1 MiB leaves";
+
+	// meow_stream gives different results than meow_hash, so its format is versioned separately.
+	constexpr int32_t meow_stream_hash_version = 1;
+	constexpr const char meow_stream_hash_version_name[] = "MeowStream 1 - length folded into finalization";
+
+	namespace detail
+	{
+		/* Checkpoints of meow_state and meow_stream are laid out as the magic "MWCK", the format, the kind of hasher, the length of the carried partial block,
+		 * the version of the hash, 4 zero bytes, the seed, the total length, the number of bytes absorbed, a check value, the sixteen 128-bit lanes of the streams,
+		 * and the carried bytes, all little endian. The lanes are stored in the same order for every N, so a checkpoint can be resumed with another N. */
+		constexpr uint8_t checkpoint_magic[4] = { 'M', 'W', 'C', 'K' };
+		constexpr uint8_t checkpoint_format = 1;
+		constexpr size_t checkpoint_check_offset = 40;
+		constexpr size_t checkpoint_header_size = 48;
+
+		enum class checkpoint_kind : uint8_t { state = 1, stream = 2 };
+
+		struct checkpoint_fields
+		{
+			checkpoint_kind kind;
+			int32_t version;
+			uint64_t seed;
+			uint64_t total_len;
+			uint64_t absorbed;
+			size_t carry_len;
+		};
+
+		// The check value is the hash of the checkpoint with the check value zeroed.
+		inline uint64_t checkpoint_check(std::vector<uint8_t> checkpoint)
+		{
+			std::memset(checkpoint.data() + checkpoint_check_offset, 0, sizeof(uint64_t));
+			return meow_hash_impl<128, false, 64>(checkpoint.data(), checkpoint.size(), 0)[0];
+		}
+
+		template <size_t N>
+		std::vector<uint8_t> write_checkpoint(const checkpoint_fields& fields, const meow_streams<N>& streams, const uint8_t* carry)
+		{
+			static_assert(sizeof(streams) == 256, "meow_streams is expected to hold the sixteen streams back to back.");
+
+			std::vector<uint8_t> checkpoint(checkpoint_header_size + sizeof(streams) + fields.carry_len, 0);
+			uint16_t carry_len = static_cast<uint16_t>(fields.carry_len);
+
+			std::memcpy(checkpoint.data(), checkpoint_magic, sizeof(checkpoint_magic));
+			checkpoint[4] = checkpoint_format;
+			checkpoint[5] = static_cast<uint8_t>(fields.kind);
+			std::memcpy(checkpoint.data() + 6, &carry_len, sizeof(carry_len));
+			std::memcpy(checkpoint.data() + 8, &fields.version, sizeof(fields.version));
+			std::memcpy(checkpoint.data() + 16, &fields.seed, sizeof(fields.seed));
+			std::memcpy(checkpoint.data() + 24, &fields.total_len, sizeof(fields.total_len));
+			std::memcpy(checkpoint.data() + 32, &fields.absorbed, sizeof(fields.absorbed));
+			std::memcpy(checkpoint.data() + checkpoint_header_size, reinterpret_cast<const void*>(&streams), sizeof(streams));
+			std::memcpy(checkpoint.data() + checkpoint_header_size + sizeof(streams), carry, fields.carry_len);
+
+			uint64_t check = checkpoint_check(checkpoint);
+			std::memcpy(checkpoint.data() + checkpoint_check_offset, &check, sizeof(check));
+
+			return checkpoint;
+		}
+
+		/* Reads a checkpoint of the given kind and version, returning false, without touching the outputs, if it isn't a valid one.
+		 * Everything is decoded into locals and checked first, including that a state hasn't absorbed more than its total length, and only then copied out. */
+		template <size_t N>
+		bool read_checkpoint(const void* data, size_t len, checkpoint_kind kind, int32_t version, checkpoint_fields& fields, meow_streams<N>& streams, uint8_t* carry)
+		{
+			const uint8_t* src = reinterpret_cast<const uint8_t*>(data);
+
+			if (len < checkpoint_header_size + sizeof(streams) || std::memcmp(src, checkpoint_magic, sizeof(checkpoint_magic)) != 0 ||
+				src[4] != checkpoint_format || src[5] != static_cast<uint8_t>(kind))
+			{
+				return false;
+			}
+
+			checkpoint_fields read;
+			uint16_t carry_len;
+			uint64_t check;
+
+			read.kind = kind;
+			std::memcpy(&carry_len, src + 6, sizeof(carry_len));
+			std::memcpy(&read.version, src + 8, sizeof(read.version));
+			std::memcpy(&read.seed, src + 16, sizeof(read.seed));
+			std::memcpy(&read.total_len, src + 24, sizeof(read.total_len));
+			std::memcpy(&read.absorbed, src + 32, sizeof(read.absorbed));
+			std::memcpy(&check, src + checkpoint_check_offset, sizeof(check));
+			read.carry_len = carry_len;
+
+			if (read.version != version || read.carry_len != read.absorbed % 256 || len != checkpoint_header_size + sizeof(streams) + read.carry_len ||
+				(kind == checkpoint_kind::state && read.absorbed > read.total_len) || checkpoint_check(std::vector<uint8_t>(src, src + len)) != check)
+			{
+				return false;
+			}
+
+			meow_streams<N> read_streams;
+			std::memcpy(reinterpret_cast<void*>(&read_streams), src + checkpoint_header_size, sizeof(read_streams));
+
+			fields = read;
+			streams = read_streams;
+			std::memcpy(carry, src + checkpoint_header_size + sizeof(streams), read.carry_len);
+
+			return true;
+		}
+	}
+
+	// Incremental hasher for input that arrives in pieces. The total length of the input is a part of the initialization vector,
+	// so it has to be declared up front. Absorbing the input in chunks of any size gives the same result as meow_hash<N, Align, R> on the whole input.
+	// Absorbing more than total_len bytes, or finalizing before all of them were absorbed, gives an unspecified hash value.
+	template <size_t N, size_t R>
+	class meow_state
+	{
+	public:
+
+		static_assert(N == 128 || N == 256 || N == 512, "meow_state can only be declared in 128, 256, or 512 bit mode.");
+
+		meow_state(uint64_t total_len, uint64_t seed = 0) :
+			init_vector(detail::make_init_vector(seed, total_len)), streams(init_vector),
+			total_len(total_len), block_end(total_len - (total_len % 256)), absorbed(0), carry_len(0) {}
+
+		void absorb(const void* input, size_t len)
+		{
+			const uint8_t* src = reinterpret_cast<const uint8_t*>(input);
+
+			while (len > 0 && absorbed < block_end)
+			{
+				if (carry_len == 0 && len >= 256)
+				{
+					uint64_t block_count = std::min<uint64_t>(len / 256, (block_end - absorbed) / 256);
+					uint64_t block_bytes = block_count * 256;
+
+					// Chunks coming from aligned buffers, like the ones used for O_DIRECT reads, take the Align = true path.
+					if (reinterpret_cast<uintptr_t>(src) % alignof(hash_type_t<N>) == 0)
+					{
+						while (block_count-- > 0)
+						{
+							detail::absorb_block<N, true>(streams, reinterpret_cast<const hash_type_t<N>*>(src));
+							src += 256;
+						}
+					}
+					else
+					{
+						while (block_count-- > 0)
+						{
+							detail::absorb_block<N, false>(streams, src);
+							src += 256;
+						}
+					}
+
+					absorbed += block_bytes;
+					len -= static_cast<size_t>(block_bytes);
+				}
+				else
+				{
+					size_t take = std::min<size_t>(256 - carry_len, len);
+					std::memcpy(carry.data() + carry_len, src, take);
+
+					carry_len += take;
+					absorbed += take;
+					src += take;
+					len -= take;
+
+					if (carry_len == 256)
+					{
+						detail::absorb_block<N, true>(streams, reinterpret_cast<const hash_type_t<N>*>(carry.data()));
+						carry_len = 0;
+					}
+				}
+			}
+
+			if (len > 0 && absorbed < total_len)
+			{
+				size_t take = static_cast<size_t>(std::min<uint64_t>(len, total_len - absorbed));
+				std::memcpy(carry.data() + carry_len, src, take);
+
+				carry_len += take;
+				absorbed += take;
+			}
+		}
+
+		// Absorbs len zero bytes, like absorb would from a zeroed buffer, but with the full blocks hashed from a zeroed register, without reading any memory.
+		void absorb_zeros(uint64_t len)
+		{
+			while (len > 0 && absorbed < total_len)
+			{
+				if (carry_len == 0 && len >= 256 && absorbed < block_end)
+				{
+					uint64_t block_count = std::min<uint64_t>(len / 256, (block_end - absorbed) / 256);
+
+					detail::absorb_zero_blocks<N>(streams, block_count);
+
+					absorbed += block_count * 256;
+					len -= block_count * 256;
+				}
+				else
+				{
+					size_t take = static_cast<size_t>(std::min<uint64_t>(std::min<uint64_t>(256 - carry_len, len), total_len - absorbed));
+					std::memset(carry.data() + carry_len, 0, take);
+
+					carry_len += take;
+					absorbed += take;
+					len -= take;
+
+					if (carry_len == 256)
+					{
+						detail::absorb_block<N, true>(streams, reinterpret_cast<const hash_type_t<N>*>(carry.data()));
+						carry_len = 0;
+					}
+				}
+			}
+		}
+
+		hash_t<R> finalize() const
+		{
+			detail::meow_streams<N> final_streams = streams;
+
+			if (total_len % 256 > 0)
+			{
+				detail::absorb_partial<N>(final_streams, init_vector, carry.data(), carry_len);
+			}
+
+			return detail::finalize<N, R>(final_streams, init_vector);
+		}
+
+		uint64_t bytes_absorbed() const
+		{
+			return absorbed;
+		}
+
+		uint64_t total_length() const
+		{
+			return total_len;
+		}
+
+		/* Exports the state as a checkpoint, which restore turns back into the same state, in this process or another one, with any N,
+		 * so that hashing a long input can be resumed after a restart without absorbing the input from the beginning. */
+		std::vector<uint8_t> checkpoint() const
+		{
+			detail::checkpoint_fields fields = { detail::checkpoint_kind::state, meow_hash_version, init_vector[0], total_len, absorbed, carry_len };
+			return detail::write_checkpoint<N>(fields, streams, carry.data());
+		}
+
+		// Replaces the state with the one saved in a checkpoint. Returns false, leaving the state as it was, if the checkpoint is damaged, or of another version or hasher.
+		bool restore(const void* checkpoint, size_t len)
+		{
+			detail::checkpoint_fields fields;
+
+			if (!detail::read_checkpoint<N>(checkpoint, len, detail::checkpoint_kind::state, meow_hash_version, fields, streams, carry.data()))
+			{
+				return false;
+			}
+
+			init_vector = detail::make_init_vector(fields.seed, fields.total_len);
+			total_len = fields.total_len;
+			block_end = total_len - (total_len % 256);
+			absorbed = fields.absorbed;
+			carry_len = fields.carry_len;
+
+			return true;
+		}
+
+		bool restore(const std::vector<uint8_t>& checkpoint)
+		{
+			return restore(checkpoint.data(), checkpoint.size());
+		}
+
+	private:
+
+		hash_t<64> init_vector;
+		detail::meow_streams<N> streams;
+		alignas(64) std::array<uint8_t, 256> carry;
+
+		uint64_t total_len;
+		uint64_t block_end;
+		uint64_t absorbed;
+		size_t carry_len;
+	};
+
+	// How many 256 byte blocks meow_hash_resume absorbs between checks of the cancellation token, 4 MiB, which takes about a millisecond on slow machines.
+	constexpr uint64_t meow_cancel_interval = 16384;
+
+	// Called with the number of bytes absorbed so far, and the total length of the input.
+	using meow_progress_callback = std::function<void(uint64_t absorbed, uint64_t total)>;
+
+	/* Absorbs the input the state was created for, the whole total_length() bytes of it, starting after the bytes_absorbed() by the state,
+	 * so a cancelled call is resumed by calling it again with the same input and state. Every interval blocks, it checks the cancel token and calls progress, if given.
+	 * Returns true once the whole input was absorbed, and the state is ready to be finalized, or false if it was cancelled. */
+	template <size_t N, size_t R>
+	bool meow_hash_resume(meow_state<N, R>& state, const void* input, const std::atomic<bool>& cancel, const meow_progress_callback& progress = nullptr, uint64_t interval = meow_cancel_interval)
+	{
+		const uint8_t* src = reinterpret_cast<const uint8_t*>(input);
+		uint64_t total = state.total_length();
+		uint64_t step = std::max<uint64_t>(interval, 1) * 256;
+
+		// The steps are whole blocks, so the blocks only go through the carry buffer at the end of the input, or after resuming a state fed by absorb.
+		while (state.bytes_absorbed() < total)
+		{
+			if (cancel.load(std::memory_order_relaxed))
+			{
+				return false;
+			}
+
+			uint64_t offset = state.bytes_absorbed();
+			state.absorb(src + offset, static_cast<size_t>(std::min(step, total - offset)));
+
+			if (progress)
+			{
+				progress(state.bytes_absorbed(), total);
+			}
+		}
+
+		return true;
+	}
+
+	/* Hashes input like meow_hash<N, false, R>, but can be cancelled, and reports its progress, see meow_hash_resume. Returns the state, which is complete
+	 * if its bytes_absorbed() equals len, and finalize() then gives the hash, or can be passed to meow_hash_resume, with the same input, to carry on. */
+	template <size_t N, size_t R = N>
+	meow_state<N, R> meow_hash_cancellable(const void* input, size_t len, uint64_t seed, const std::atomic<bool>& cancel,
+		const meow_progress_callback& progress = nullptr, uint64_t interval = meow_cancel_interval)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash_cancellable can only be called in 128, 256, or 512 bit mode.");
+
+		meow_state<N, R> state(len, seed);
+		meow_hash_resume(state, input, cancel, progress, interval);
+		return state;
+	}
+
+	namespace detail
+	{
+		// Takes the place of the length in the initialization vector of meow_stream, which starts hashing before the length is known.
+		constexpr uint64_t stream_init_tag = 0x6D656F7773747231ULL;
+
+		MEOWH_FORCE_STATIC_INLINE hash_t<64> make_stream_init_vector(uint64_t seed)
+		{
+			return make_init_vector(seed, stream_init_tag);
+		}
+
+		template <size_t N, bool Align = false, size_t R = N>
+		static hash_t<R> meow_hash_stream_impl(const uint8_t* src, uint64_t len, uint64_t seed)
+		{
+			hash_t<64> init_vector = make_stream_init_vector(seed);
+			meow_streams<N> streams(init_vector);
+
+			absorb_input<N, Align>(streams, init_vector, src, len);
+
+			return finalize<N, R>(streams, make_init_vector(seed, len));
+		}
+	}
+
+	/* Incremental hasher for input of unknown length, like sockets or the output of compressors, MeowStream. It starts from an initialization vector
+	 * without the length, pads the final partial block with it, and folds the length in at the end, by finalizing with the initialization vector of meow_hash,
+	 * so it hashes in a single pass, at the same cost per block as meow_hash, with a fixed amount of memory. Its results are NOT the same as those of meow_hash
+	 * and meow_state, and its format is versioned separately, by meow_stream_hash_version. */
+	template <size_t N, size_t R = N>
+	class meow_stream
+	{
+	public:
+
+		static_assert(N == 128 || N == 256 || N == 512, "meow_stream can only be declared in 128, 256, or 512 bit mode.");
+
+		explicit meow_stream(uint64_t seed = 0) :
+			seed(seed), init_vector(detail::make_stream_init_vector(seed)), streams(init_vector), absorbed(0), carry_len(0) {}
+
+		void absorb(const void* input, size_t len)
+		{
+			const uint8_t* src = reinterpret_cast<const uint8_t*>(input);
+			absorbed += len;
+
+			if (carry_len > 0)
+			{
+				size_t take = std::min<size_t>(256 - carry_len, len);
+				std::memcpy(carry.data() + carry_len, src, take);
+
+				carry_len += take;
+				src += take;
+				len -= take;
+
+				if (carry_len < 256)
+				{
+					return;
+				}
+
+				detail::absorb_block<N, true>(streams, reinterpret_cast<const hash_type_t<N>*>(carry.data()));
+				carry_len = 0;
+			}
+
+			// A block is absorbed as soon as it's complete, even if it turns out to be the last one, which is what meow_hash does with inputs that are a multiple of 256 bytes long.
+			size_t block_count = len / 256;
+
+			if (reinterpret_cast<uintptr_t>(src) % alignof(hash_type_t<N>) == 0)
+			{
+				for (size_t block = 0; block < block_count; block++)
+				{
+					detail::absorb_block<N, true>(streams, reinterpret_cast<const hash_type_t<N>*>(src + block * 256));
+				}
+			}
+			else
+			{
+				for (size_t block = 0; block < block_count; block++)
+				{
+					detail::absorb_block<N, false>(streams, src + block * 256);
+				}
+			}
+
+			carry_len = len - block_count * 256;
+			std::memcpy(carry.data(), src + block_count * 256, carry_len);
+		}
+
+		hash_t<R> finalize() const
+		{
+			detail::meow_streams<N> final_streams = streams;
+
+			if (carry_len > 0)
+			{
+				detail::absorb_partial<N>(final_streams, init_vector, carry.data(), carry_len);
+			}
+
+			return detail::finalize<N, R>(final_streams, detail::make_init_vector(seed, absorbed));
+		}
+
+		uint64_t bytes_absorbed() const
+		{
+			return absorbed;
+		}
+
+		// Exports the stream as a checkpoint, like meow_state::checkpoint.
+		std::vector<uint8_t> checkpoint() const
+		{
+			detail::checkpoint_fields fields = { detail::checkpoint_kind::stream, meow_stream_hash_version, seed, 0, absorbed, carry_len };
+			return detail::write_checkpoint<N>(fields, streams, carry.data());
+		}
+
+		// Replaces the stream with the one saved in a checkpoint, like meow_state::restore.
+		bool restore(const void* checkpoint, size_t len)
+		{
+			detail::checkpoint_fields fields;
+
+			if (!detail::read_checkpoint<N>(checkpoint, len, detail::checkpoint_kind::stream, meow_stream_hash_version, fields, streams, carry.data()))
+			{
+				return false;
+			}
+
+			seed = fields.seed;
+			init_vector = detail::make_stream_init_vector(seed);
+			absorbed = fields.absorbed;
+			carry_len = fields.carry_len;
+
+			return true;
+		}
+
+		bool restore(const std::vector<uint8_t>& checkpoint)
+		{
+			return restore(checkpoint.data(), checkpoint.size());
+		}
+
+	private:
+
+		uint64_t seed;
+		hash_t<64> init_vector;
+		detail::meow_streams<N> streams;
+		alignas(64) std::array<uint8_t, 256> carry;
+
+		uint64_t absorbed;
+		size_t carry_len;
+	};
+
+	// MeowStream of a whole input, the same as absorbing it into a meow_stream<N, R> and finalizing it.
+	template <size_t N, bool Align = false, size_t R = N>
+	hash_t<R> meow_hash_stream(const void* input, size_t len, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash_stream can only be called in 128, 256, or 512 bit mode.");
+		return detail::meow_hash_stream_impl<N, Align, R>(reinterpret_cast<const uint8_t*>(input), len, seed);
+	}
+
+	namespace detail
+	{
+		template <typename Segment, typename = void>
+		struct is_iovec : std::false_type {};
+
+		template <typename Segment>
+		struct is_iovec<Segment, std::void_t<decltype(std::declval<Segment>().iov_base), decltype(std::declval<Segment>().iov_len)>> : std::true_type {};
+
+		// The bytes of a segment, which is either an iovec, or anything with data() and size(), like std::string_view, std::vector or std::span.
+		template <typename Segment>
+		MEOWH_FORCE_STATIC_INLINE std::pair<const void*, size_t> segment_bytes(const Segment& segment)
+		{
+			if constexpr (is_iovec<Segment>::value)
+			{
+				return { segment.iov_base, segment.iov_len };
+			}
+			else
+			{
+				return { segment.data(), segment.size() * sizeof(*segment.data()) };
+			}
+		}
+
+		/* Hashes the concatenation of the segments, without copying them into a single buffer. The blocks inside a segment are hashed in place,
+		 * and only the blocks that straddle the boundaries between segments are stitched together in the 256 byte carry buffer of a meow_state. */
+		template <size_t N, size_t R, typename SegmentIterator>
+		hash_t<R> meow_hash_segments(SegmentIterator begin, SegmentIterator end, uint64_t seed)
+		{
+			uint64_t total_len = 0;
+
+			for (SegmentIterator segment = begin; segment != end; ++segment)
+			{
+				total_len += segment_bytes(*segment).second;
+			}
+
+			meow_state<N, R> state(total_len, seed);
+
+			for (SegmentIterator segment = begin; segment != end; ++segment)
+			{
+				std::pair<const void*, size_t> bytes = segment_bytes(*segment);
+				state.absorb(bytes.first, bytes.second);
+			}
+
+			return state.finalize();
+		}
+	}
+
+	// Hashes count segments, like an array of iovecs, giving the same result as meow_hash<N, false, R> over their concatenation.
+	template <size_t N, size_t R = N, typename Segment>
+	hash_t<R> meow_hash_v(const Segment* segments, size_t count, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash_v can only be called in 128, 256, or 512 bit mode.");
+		return detail::meow_hash_segments<N, R>(segments, segments + count, seed);
+	}
+
+	// Hashes a range of segments, like a std::vector<std::string_view> or a std::span<std::span<const std::byte>>, giving the same result as meow_hash<N, false, R> over their concatenation.
+	template <size_t N, size_t R = N, typename SegmentRange, typename = std::enable_if_t<!std::is_pointer<SegmentRange>::value && !std::is_array<SegmentRange>::value>>
+	hash_t<R> meow_hash_v(const SegmentRange& segments, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash_v can only be called in 128, 256, or 512 bit mode.");
+		return detail::meow_hash_segments<N, R>(std::begin(segments), std::end(segments), seed);
+	}
+
+	/* A 2D or 3D view of image or texture data: slices of rows of row_bytes bytes each, with pitch bytes between the starts of the rows of a slice,
+	 * and slice_pitch bytes between the starts of the slices. A 2D view has a single slice. The view covers the same bytes as the packed tile
+	 * that's row_bytes * rows * slices long, and the padding between the rows is never read. */
+	struct meow_strided_view
+	{
+		const void* base;
+		size_t row_bytes;
+		size_t pitch;
+		size_t rows;
+		size_t slices = 1;
+		size_t slice_pitch = 0;
+	};
+
+	namespace detail
+	{
+		MEOWH_FORCE_STATIC_INLINE uint64_t strided_bytes(const meow_strided_view& view)
+		{
+			return static_cast<uint64_t>(view.row_bytes) * view.rows * view.slices;
+		}
+
+		// Absorbs the rows of the view in order, merging rows that follow each other in memory, like those of a tightly packed tile, into a single run.
+		template <size_t N, size_t R>
+		void absorb_strided(meow_state<N, R>& state, const meow_strided_view& view)
+		{
+			const uint8_t* run = nullptr;
+			size_t run_len = 0;
+
+			for (size_t slice = 0; slice < view.slices; slice++)
+			{
+				const uint8_t* row = reinterpret_cast<const uint8_t*>(view.base) + slice * view.slice_pitch;
+
+				for (size_t k = 0; k < view.rows; k++, row += view.pitch)
+				{
+					if (run + run_len != row)
+					{
+						state.absorb(run, run_len);
+						run = row;
+						run_len = 0;
+					}
+
+					run_len += view.row_bytes;
+				}
+			}
+
+			state.absorb(run, run_len);
+		}
+	}
+
+	// Hashes the rows of a view without packing them, giving the same result as meow_hash<N, false, R> over the packed tile.
+	template <size_t N, size_t R = N>
+	hash_t<R> meow_hash_strided(const meow_strided_view& view, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash_strided can only be called in 128, 256, or 512 bit mode.");
+
+		meow_state<N, R> state(detail::strided_bytes(view), seed);
+		detail::absorb_strided(state, view);
+		return state.finalize();
+	}
+
+	// Hashes rows rows of row_bytes bytes, pitch bytes apart, like a 2D texture or a tile of a larger image.
+	template <size_t N, size_t R = N>
+	hash_t<R> meow_hash_strided(const void* base, size_t row_bytes, size_t pitch, size_t rows, uint64_t seed = 0)
+	{
+		return meow_hash_strided<N, R>(meow_strided_view{ base, row_bytes, pitch, rows, 1, 0 }, seed);
+	}
+
+	// Hashes slices slices of rows rows each, like a 3D texture or a texture array, with slice_pitch bytes between the starts of the slices.
+	template <size_t N, size_t R = N>
+	hash_t<R> meow_hash_strided(const void* base, size_t row_bytes, size_t pitch, size_t rows, size_t slices, size_t slice_pitch, uint64_t seed = 0)
+	{
+		return meow_hash_strided<N, R>(meow_strided_view{ base, row_bytes, pitch, rows, slices, slice_pitch }, seed);
+	}
+
+	// Hashes count views as a single message, like every level of a mip chain, giving the same result as meow_hash<N, false, R> over their packed tiles, one after the other.
+	template <size_t N, size_t R = N>
+	hash_t<R> meow_hash_strided(const meow_strided_view* views, size_t count, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash_strided can only be called in 128, 256, or 512 bit mode.");
+
+		uint64_t total_len = 0;
+
+		for (size_t k = 0; k < count; k++)
+		{
+			total_len += detail::strided_bytes(views[k]);
+		}
+
+		meow_state<N, R> state(total_len, seed);
+
+		for (size_t k = 0; k < count; k++)
+		{
+			detail::absorb_strided(state, views[k]);
+		}
+
+		return state.finalize();
+	}
+
+	// Hashes count views on their own, like the tiles of a grid, writing the same results as count separate calls to meow_hash_strided would.
+	template <size_t N, size_t R = N>
+	void meow_hash_strided_batch(const meow_strided_view* views, hash_t<R>* results, size_t count, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash_strided_batch can only be called in 128, 256, or 512 bit mode.");
+
+		for (size_t k = 0; k < count; k++)
+		{
+			results[k] = meow_hash_strided<N, R>(views[k], seed);
+		}
+	}
+
+#ifdef _MEOWH_DISPATCH
+	namespace detail
+	{
+		MEOWH_FORCE_STATIC_INLINE size_t detect_widest_kernel()
+		{
+#ifdef _MSC_VER
+			int info[4];
+
+			__cpuid(info, 0);
+			if (info[0] < 7)
+			{
+				return 128;
+			}
+
+			__cpuid(info, 1);
+			bool aes = (info[2] & (1 << 25)) != 0;
+			bool os_xsave = (info[2] & (1 << 27)) != 0;
+
+			__cpuidex(info, 7, 0);
+			bool avx2 = (info[1] & (1 << 5)) != 0;
+			bool avx512f = (info[1] & (1 << 16)) != 0;
+			bool vaes = (info[2] & (1 << 9)) != 0;
+
+			uint64_t xcr0 = os_xsave ? _xgetbv(0) : 0;
+			bool os_ymm = (xcr0 & 0x06) == 0x06;
+			bool os_zmm = (xcr0 & 0xE6) == 0xE6;
+#else
+			__builtin_cpu_init();
+
+			bool aes = __builtin_cpu_supports("aes");
+			bool avx2 = __builtin_cpu_supports("avx2");
+			bool avx512f = __builtin_cpu_supports("avx512f");
+			bool vaes = __builtin_cpu_supports("vaes");
+
+			// libgcc and compiler-rt only report AVX features when the OS saves the wider registers.
+			bool os_ymm = true;
+			bool os_zmm = true;
+#endif
+
+			if (!aes)
+			{
+				return 0;
+			}
+			if (vaes && avx512f && os_zmm)
+			{
+				return 512;
+			}
+			if (vaes && avx2 && os_ymm)
+			{
+				return 256;
+			}
+			return 128;
+		}
+
+		constexpr hash_t<64> meow_hash_ct_impl(std::string_view input, uint64_t seed);
+
+		template <size_t R>
+		using meow_kernel_t = hash_t<R>(*)(const uint8_t*, uint64_t, uint64_t);
+
+		template <size_t R>
+		MEOWH_TARGET_AES MEOWH_FLATTEN hash_t<R> meow_hash_kernel_128(const uint8_t* src, uint64_t len, uint64_t seed)
+		{
+			return meow_hash_impl<128, false, R>(src, len, seed);
+		}
+
+		template <size_t R>
+		MEOWH_TARGET_VAES_256 MEOWH_FLATTEN hash_t<R> meow_hash_kernel_256(const uint8_t* src, uint64_t len, uint64_t seed)
+		{
+			return meow_hash_impl<256, false, R>(src, len, seed);
+		}
+
+		template <size_t R>
+		MEOWH_TARGET_VAES_512 MEOWH_FLATTEN hash_t<R> meow_hash_kernel_512(const uint8_t* src, uint64_t len, uint64_t seed)
+		{
+			return meow_hash_impl<512, false, R>(src, len, seed);
+		}
+
+		// For CPUs without AES-NI, where every other kernel would fault with an illegal instruction. It uses the software AES of meow_hash_ct, and is many times slower.
+		template <size_t R>
+		hash_t<R> meow_hash_kernel_soft(const uint8_t* src, uint64_t len, uint64_t seed)
+		{
+			return meow_hash_ct_impl(std::string_view(reinterpret_cast<const char*>(src), static_cast<size_t>(len)), seed);
+		}
+	}
+
+	/* Width in bits of the widest MeowHash kernel the running CPU supports: 128 for AES-NI, 256 for VAES with AVX2, 512 for VAES with AVX-512F,
+	 * and 0 for CPUs without AES-NI, which get the software AES of meow_hash_ct. */
+	inline size_t meow_hash_dispatch_width()
+	{
+		static const size_t width = detail::detect_widest_kernel();
+		return width;
+	}
+
+	// Hashes with the widest kernel the running CPU supports, picked at the first call.
+	// MeowHash1, 2 and 4 produce identical hashes, so the result doesn't depend on the machine it was computed on.
+	template <size_t R = 128>
+	hash_t<R> meow_hash_dispatch(const void* input, size_t len, uint64_t seed = 0)
+	{
+		static const detail::meow_kernel_t<R> kernel =
+			meow_hash_dispatch_width() == 512 ? detail::meow_hash_kernel_512<R> :
+			meow_hash_dispatch_width() == 256 ? detail::meow_hash_kernel_256<R> :
+			meow_hash_dispatch_width() == 128 ? detail::meow_hash_kernel_128<R> :
+			detail::meow_hash_kernel_soft<R>;
+
+		return kernel(reinterpret_cast<const uint8_t*>(input), len, seed);
+	}
+#endif
+
+	// Inputs shorter than this are hashed on the calling thread by meow_hash_parallel, since starting the threads would cost more than it saves.
+	constexpr size_t meow_hash_parallel_threshold = 16 * 1024 * 1024;
+
+	namespace detail
+	{
+		// Absorbs all full blocks into L consecutive lanes, with the first of them at lanes[0] and reading src + lane index * lane size in each block.
+		template <size_t N, bool Align, size_t L>
+		static void absorb_lane_range(hash_type_t<N>* lanes, const uint8_t* src, uint64_t block_count)
+		{
+			constexpr size_t lane_size = sizeof(hash_type_t<N>);
+
+			hash_type_t<N> acc[L];
+			std::copy(lanes, lanes + L, acc);
+
+			while (block_count-- > 0)
+			{
+				for (size_t l = 0; l < L; l++)
+				{
+					acc[l] = aes_load_lane<N, Align>(acc[l], src + l * lane_size);
+				}
+				src += 256;
+			}
+
+			std::copy(acc, acc + L, lanes);
+		}
+
+		template <size_t N, bool Align, size_t L>
+		static void absorb_lanes_parallel(hash_type_t<N>* lanes, const uint8_t* src, uint64_t block_count, size_t thread_count)
+		{
+			constexpr size_t lane_size = sizeof(hash_type_t<N>);
+
+			std::vector<std::thread> workers;
+			workers.reserve(thread_count - 1);
+
+			for (size_t t = 1; t < thread_count; t++)
+			{
+				try
+				{
+					workers.emplace_back(absorb_lane_range<N, Align, L>, lanes + t * L, src + t * L * lane_size, block_count);
+				}
+				catch (const std::system_error&)
+				{
+					absorb_lane_range<N, Align, L>(lanes + t * L, src + t * L * lane_size, block_count);
+				}
+			}
+
+			absorb_lane_range<N, Align, L>(lanes, src, block_count);
+
+			for (std::thread& worker : workers)
+			{
+				worker.join();
+			}
+		}
+	}
+
+	// Hashes a single large input on several threads, giving the same result as meow_hash<N, Align, R>.
+	// Each 128, 256, or 512 bit lane of the sixteen streams only absorbs its own part of every 256 byte block, so the lanes are split between up to
+	// 16, 8, or 4 threads respectively and only joined for the finalization. max_threads = 0 uses std::thread::hardware_concurrency().
+	template <size_t N, bool Align = false, size_t R = N>
+	hash_t<R> meow_hash_parallel(const void* input, size_t len, uint64_t seed = 0, size_t threshold = meow_hash_parallel_threshold, size_t max_threads = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash_parallel can only be called in 128, 256, or 512 bit mode.");
+
+		constexpr size_t lane_count = 256 / sizeof(hash_type_t<N>);
+
+		size_t thread_limit = std::min<size_t>(max_threads > 0 ? max_threads : std::thread::hardware_concurrency(), lane_count);
+		size_t thread_count = 1;
+
+		while (thread_count * 2 <= thread_limit)
+		{
+			thread_count *= 2;
+		}
+
+		if (len < threshold || thread_count < 2)
+		{
+			return detail::meow_hash_impl<N, Align, R>(reinterpret_cast<const uint8_t*>(input), len, seed);
+		}
+
+		const uint8_t* src = reinterpret_cast<const uint8_t*>(input);
+
+		hash_t<64> init_vector = detail::make_init_vector(seed, len);
+		detail::meow_streams<N> streams(init_vector);
+
+		static_assert(sizeof(streams) == 256, "meow_streams is expected to hold the sixteen streams back to back.");
+
+		hash_type_t<N> lanes[lane_count];
+		std::memcpy(reinterpret_cast<void*>(lanes), reinterpret_cast<const void*>(&streams), sizeof(streams));
+
+		uint64_t block_count = len / 256;
+
+		switch (lane_count / thread_count)
+		{
+		case 1: detail::absorb_lanes_parallel<N, Align, 1>(lanes, src, block_count, thread_count); break;
+		case 2: detail::absorb_lanes_parallel<N, Align, 2>(lanes, src, block_count, thread_count); break;
+		case 4: detail::absorb_lanes_parallel<N, Align, 4>(lanes, src, block_count, thread_count); break;
+		case 8: detail::absorb_lanes_parallel<N, Align, 8>(lanes, src, block_count, thread_count); break;
+		}
+
+		std::memcpy(reinterpret_cast<void*>(&streams), reinterpret_cast<const void*>(lanes), sizeof(streams));
+
+		if (len % 256 > 0)
+		{
+			detail::absorb_partial<N>(streams, init_vector, src + block_count * 256, len % 256);
+		}
+
+		return detail::finalize<N, R>(streams, init_vector);
+	}
+
+	// Size of the leaves of meow_tree_hash. It's a part of the tree format, so changing it changes every digest and requires bumping meow_tree_hash_version.
+	constexpr size_t meow_tree_leaf_size = 1024 * 1024;
+
+	namespace detail
+	{
+		// Threads take the next unhashed leaf from a shared counter, so a thread that got delayed doesn't hold up the others.
+		template <size_t N, bool Align>
+		static void hash_tree_leaves(hash_t<64>* digests, const uint8_t* src, uint64_t len, uint64_t leaf_count, uint64_t seed, std::atomic<uint64_t>* next_leaf)
+		{
+			for (uint64_t leaf = next_leaf->fetch_add(1, std::memory_order_relaxed); leaf < leaf_count; leaf = next_leaf->fetch_add(1, std::memory_order_relaxed))
+			{
+				uint64_t offset = leaf * meow_tree_leaf_size;
+				digests[leaf] = meow_hash_impl<N, Align, 64>(src + offset, std::min<uint64_t>(len - offset, meow_tree_leaf_size), seed);
+			}
+		}
+	}
+
+	/* MeowTree, a separate hash for scaling a single huge input across any number of cores, which does NOT give the same results as meow_hash.
+	 * The input is split into leaves of meow_tree_leaf_size bytes, the last one possibly shorter, and each is hashed with meow_hash into a 512 bit digest.
+	 * The result is the meow_hash of all the leaf digests laid out one after another, with the same seed. An empty input is a single empty leaf.
+	 * max_threads = 0 uses std::thread::hardware_concurrency(). The digests don't depend on N or on the number of threads. */
+	template <size_t N, bool Align = false, size_t R = N>
+	hash_t<R> meow_tree_hash(const void* input, size_t len, uint64_t seed = 0, size_t max_threads = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_tree_hash can only be called in 128, 256, or 512 bit mode.");
+
+		const uint8_t* src = reinterpret_cast<const uint8_t*>(input);
+
+		uint64_t leaf_count = std::max<uint64_t>((len + meow_tree_leaf_size - 1) / meow_tree_leaf_size, 1);
+		std::vector<hash_t<64>> digests(static_cast<size_t>(leaf_count));
+
+		size_t thread_count = std::min<uint64_t>(max_threads > 0 ? max_threads : std::max(std::thread::hardware_concurrency(), 1u), leaf_count);
+		std::atomic<uint64_t> next_leaf(0);
+
+		std::vector<std::thread> workers;
+		workers.reserve(thread_count - 1);
+
+		for (size_t t = 1; t < thread_count; t++)
+		{
+			try
+			{
+				workers.emplace_back(detail::hash_tree_leaves<N, Align>, digests.data(), src, len, leaf_count, seed, &next_leaf);
+			}
+			catch (const std::system_error&)
+			{
+				// The leaves are shared, so the threads that did start pick up the work of this one.
+				break;
+			}
+		}
+
+		detail::hash_tree_leaves<N, Align>(digests.data(), src, len, leaf_count, seed, &next_leaf);
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+
+		return detail::meow_hash_impl<N, false, R>(reinterpret_cast<const uint8_t*>(digests.data()), leaf_count * sizeof(hash_t<64>), seed);
+	}
+
+	namespace detail
+	{
+		template <size_t N>
+		MEOWH_FORCE_STATIC_INLINE hash_type_t<N> aesdec(hash_type_t<N> a, hash_type_t<N> b)
+		{
+			if constexpr (N == 128)
+			{
+				return aesdec_128(a, b);
+			}
+			else if constexpr (N == 256)
+			{
+				return aesdec_256(a, b);
+			}
+			else if constexpr (N == 512)
+			{
+				return aesdec_512(a, b);
+			}
+		}
+
+		template <size_t N>
+		MEOWH_FORCE_STATIC_INLINE hash_type_t<N> load_lanes(const uint8_t* const* src, size_t offset)
+		{
+			if constexpr (N == 128)
+			{
+				return load_lanes_128(src, offset);
+			}
+			else if constexpr (N == 256)
+			{
+				return load_lanes_256(src, offset);
+			}
+			else if constexpr (N == 512)
+			{
+				return load_lanes_512(src, offset);
+			}
+		}
+
+		template <size_t N>
+		MEOWH_FORCE_STATIC_INLINE hash_type_t<N> set_lanes(const uint64_t* lo, const uint64_t* hi)
+		{
+			if constexpr (N == 128)
+			{
+				return set_lanes_128(lo, hi);
+			}
+			else if constexpr (N == 256)
+			{
+				return set_lanes_256(lo, hi);
+			}
+			else if constexpr (N == 512)
+			{
+				return set_lanes_512(lo, hi);
+			}
+		}
+
+		/* Hashes up to N / 128 messages shorter than a block at once. Each message is absorbed on its own, through the same in-register path as meow_hash,
+		 * which finalizes such inputs 128 bits wide. The streams are then transposed, so that vector j holds the j-th 128 bit lane of the streams of every message,
+		 * one message per element, and the finalization runs on all the messages with each instruction, while its four stream rotations become a renaming of the vectors. */
+		template <size_t N, size_t R>
+		static void meow_hash_batch_group(const uint8_t* const* inputs, const size_t* lens, hash_t<R>* const* results, size_t count, uint64_t seed)
+		{
+			constexpr size_t K = N / 128;
+
+			// The streams are loaded straight from where they were absorbed, so that the stores forward to the loads.
+			meow_streams<128> short_streams[K];
+			const uint8_t* stream_src[K];
+
+			uint64_t iv_lo[K];
+			uint64_t iv_hi[K];
+
+			for (size_t k = 0; k < K; k++)
+			{
+				size_t len = k < count ? lens[k] : 0;
+
+				iv_lo[k] = seed;
+				iv_hi[k] = seed + len + 1;
+
+				hash_t<64> init_vector = make_init_vector(seed, len);
+
+				short_streams[k] = meow_streams<128>(init_vector);
+				absorb_short(short_streams[k], init_vector, k < count ? inputs[k] : nullptr, len);
+				stream_src[k] = reinterpret_cast<const uint8_t*>(&short_streams[k]);
+			}
+
+			hash_type_t<N> init_vector = set_lanes<N>(iv_lo, iv_hi);
+			hash_type_t<N> streams[16];
+
+			for (size_t j = 0; j < 16; j++)
+			{
+				streams[j] = load_lanes<N>(stream_src, j * 16);
+			}
+
+			// The four lanes of the result are kept in their own variables, so that they stay in registers for the whole finalization.
+			// After r rotations, lane i of the stream holding lanes 4s to 4s + 3 holds the original lane 4s + (i + r) % 4.
+			hash_type_t<N> ret_0 = init_vector;
+			hash_type_t<N> ret_1 = init_vector;
+			hash_type_t<N> ret_2 = init_vector;
+			hash_type_t<N> ret_3 = init_vector;
+
+			for (size_t r = 0; r < 4; r++)
+			{
+				for (size_t stream = 0; stream < 4; stream++)
+				{
+					ret_0 = aesdec<N>(ret_0, streams[stream * 4 + r % 4]);
+					ret_1 = aesdec<N>(ret_1, streams[stream * 4 + (1 + r) % 4]);
+					ret_2 = aesdec<N>(ret_2, streams[stream * 4 + (2 + r) % 4]);
+					ret_3 = aesdec<N>(ret_3, streams[stream * 4 + (3 + r) % 4]);
+				}
+			}
+
+			for (size_t merge = 0; merge < 5; merge++)
+			{
+				ret_0 = aesdec<N>(ret_0, init_vector);
+				ret_1 = aesdec<N>(ret_1, init_vector);
+				ret_2 = aesdec<N>(ret_2, init_vector);
+				ret_3 = aesdec<N>(ret_3, init_vector);
+			}
+
+			hash_type_t<N> ret[4] = { ret_0, ret_1, ret_2, ret_3 };
+
+			for (size_t i = 0; i < 4; i++)
+			{
+				uint8_t lanes[K * 16];
+				std::memcpy(lanes, reinterpret_cast<const void*>(&ret[i]), K * 16);
+
+				for (size_t k = 0; k < count; k++)
+				{
+					std::memcpy(reinterpret_cast<uint8_t*>(results[k]->elem.data()) + i * 16, lanes + k * 16, 16);
+				}
+			}
+		}
+	}
+
+	/* Hashes count independent messages, inputs[m] of lens[m] bytes, writing the same results as count separate calls to meow_hash<N, false, R> would.
+	 * It only speeds up messages shorter than a block with N = 256 or 512, which are gathered N / 128 at a time, and finalized together,
+	 * one message per 128 bit element of the ymm or zmm registers, since meow_hash finalizes them only 128 bits wide.
+	 * With N = 128, and for messages of 256 bytes or more, it's a plain loop over meow_hash, no faster than calling it on each message,
+	 * since their blocks are never interleaved across messages. */
+	template <size_t N, size_t R = N>
+	void meow_hash_batch(const void* const* inputs, const size_t* lens, hash_t<R>* results, size_t count, uint64_t seed = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "meow_hash_batch can only be called in 128, 256, or 512 bit mode.");
+
+		constexpr size_t K = N / 128;
+
+		const uint8_t* group_inputs[K];
+		size_t group_lens[K];
+		hash_t<R>* group_results[K];
+		size_t group_count = 0;
+
+		for (size_t m = 0; m < count; m++)
+		{
+			const uint8_t* src = reinterpret_cast<const uint8_t*>(inputs[m]);
+
+			if (K == 1 || lens[m] >= 256)
+			{
+				results[m] = detail::meow_hash_impl<N, false, R>(src, lens[m], seed);
+				continue;
+			}
+
+			group_inputs[group_count] = src;
+			group_lens[group_count] = lens[m];
+			group_results[group_count] = results + m;
+
+			if (++group_count == K)
+			{
+				detail::meow_hash_batch_group<N, R>(group_inputs, group_lens, group_results, group_count, seed);
+				group_count = 0;
+			}
+		}
+
+		if (group_count > 0)
+		{
+			detail::meow_hash_batch_group<N, R>(group_inputs, group_lens, group_results, group_count, seed);
+		}
+	}
+
+	namespace detail
+	{
+		/* A scalar implementation of MeowHash1, with AESDEC done in software, so that it can be evaluated at compile time.
+		 * Each 128 bit lane is held as 16 bytes in memory order, which is also the column-major AES state. */
+		using ct_lane_t = std::array<uint8_t, 16>;
+
+		constexpr uint8_t ct_inv_sbox[256] =
+		{
+			0x52, 0x09, 0x6a, 0xd5, 0x30, 0x36, 0xa5, 0x38, 0xbf, 0x40, 0xa3, 0x9e, 0x81, 0xf3, 0xd7, 0xfb,
+			0x7c, 0xe3, 0x39, 0x82, 0x9b, 0x2f, 0xff, 0x87, 0x34, 0x8e, 0x43, 0x44, 0xc4, 0xde, 0xe9, 0xcb,
+			0x54, 0x7b, 0x94, 0x32, 0xa6, 0xc2, 0x23, 0x3d, 0xee, 0x4c, 0x95, 0x0b, 0x42, 0xfa, 0xc3, 0x4e,
+			0x08, 0x2e, 0xa1, 0x66, 0x28, 0xd9, 0x24, 0xb2, 0x76, 0x5b, 0xa2, 0x49, 0x6d, 0x8b, 0xd1, 0x25,
+			0x72, 0xf8, 0xf6, 0x64, 0x86, 0x68, 0x98, 0x16, 0xd4, 0xa4, 0x5c, 0xcc, 0x5d, 0x65, 0xb6, 0x92,
+			0x6c, 0x70, 0x48, 0x50, 0xfd, 0xed, 0xb9, 0xda, 0x5e, 0x15, 0x46, 0x57, 0xa7, 0x8d, 0x9d, 0x84,
+			0x90, 0xd8, 0xab, 0x00, 0x8c, 0xbc, 0xd3, 0x0a, 0xf7, 0xe4, 0x58, 0x05, 0xb8, 0xb3, 0x45, 0x06,
+			0xd0, 0x2c, 0x1e, 0x8f, 0xca, 0x3f, 0x0f, 0x02, 0xc1, 0xaf, 0xbd, 0x03, 0x01, 0x13, 0x8a, 0x6b,
+			0x3a, 0x91, 0x11, 0x41, 0x4f, 0x67, 0xdc, 0xea, 0x97, 0xf2, 0xcf, 0xce, 0xf0, 0xb4, 0xe6, 0x73,
+			0x96, 0xac, 0x74, 0x22, 0xe7, 0xad, 0x35, 0x85, 0xe2, 0xf9, 0x37, 0xe8, 0x1c, 0x75, 0xdf, 0x6e,
+			0x47, 0xf1, 0x1a, 0x71, 0x1d, 0x29, 0xc5, 0x89, 0x6f, 0xb7, 0x62, 0x0e, 0xaa, 0x18, 0xbe, 0x1b,
+			0xfc, 0x56, 0x3e, 0x4b, 0xc6, 0xd2, 0x79, 0x20, 0x9a, 0xdb, 0xc0, 0xfe, 0x78, 0xcd, 0x5a, 0xf4,
+			0x1f, 0xdd, 0xa8, 0x33, 0x88, 0x07, 0xc7, 0x31, 0xb1, 0x12, 0x10, 0x59, 0x27, 0x80, 0xec, 0x5f,
+			0x60, 0x51, 0x7f, 0xa9, 0x19, 0xb5, 0x4a, 0x0d, 0x2d, 0xe5, 0x7a, 0x9f, 0x93, 0xc9, 0x9c, 0xef,
+			0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
+			0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d
+		};
+
+		constexpr uint8_t ct_gf_mul(uint8_t a, uint8_t b)
+		{
+			uint8_t ret = 0;
+
+			while (b != 0)
+			{
+				if (b & 1)
+				{
+					ret = static_cast<uint8_t>(ret ^ a);
+				}
+				a = static_cast<uint8_t>((a & 0x80) ? ((a << 1) ^ 0x1B) : (a << 1));
+				b = static_cast<uint8_t>(b >> 1);
+			}
+
+			return ret;
+		}
+
+		// InvShiftRows, InvSubBytes and InvMixColumns of a, xored with the round key b, same as _mm_aesdec_si128.
+		constexpr ct_lane_t ct_aesdec(const ct_lane_t& a, const ct_lane_t& b)
+		{
+			ct_lane_t sub = {};
+
+			for (size_t col = 0; col < 4; col++)
+			{
+				for (size_t row = 0; row < 4; row++)
+				{
+					sub[col * 4 + row] = ct_inv_sbox[a[((col + 4 - row) % 4) * 4 + row]];
+				}
+			}
+
+			ct_lane_t ret = {};
+
+			for (size_t col = 0; col < 4; col++)
+			{
+				uint8_t s0 = sub[col * 4];
+				uint8_t s1 = sub[col * 4 + 1];
+				uint8_t s2 = sub[col * 4 + 2];
+				uint8_t s3 = sub[col * 4 + 3];
+
+				ret[col * 4] = static_cast<uint8_t>(ct_gf_mul(s0, 14) ^ ct_gf_mul(s1, 11) ^ ct_gf_mul(s2, 13) ^ ct_gf_mul(s3, 9) ^ b[col * 4]);
+				ret[col * 4 + 1] = static_cast<uint8_t>(ct_gf_mul(s0, 9) ^ ct_gf_mul(s1, 14) ^ ct_gf_mul(s2, 11) ^ ct_gf_mul(s3, 13) ^ b[col * 4 + 1]);
+				ret[col * 4 + 2] = static_cast<uint8_t>(ct_gf_mul(s0, 13) ^ ct_gf_mul(s1, 9) ^ ct_gf_mul(s2, 14) ^ ct_gf_mul(s3, 11) ^ b[col * 4 + 2]);
+				ret[col * 4 + 3] = static_cast<uint8_t>(ct_gf_mul(s0, 11) ^ ct_gf_mul(s1, 13) ^ ct_gf_mul(s2, 9) ^ ct_gf_mul(s3, 14) ^ b[col * 4 + 3]);
+			}
+
+			return ret;
+		}
+
+		constexpr ct_lane_t ct_make_init_vector(uint64_t seed, uint64_t len)
+		{
+			ct_lane_t init_vector = {};
+
+			for (size_t k = 0; k < 8; k++)
+			{
+				init_vector[k] = static_cast<uint8_t>(seed >> (8 * k));
+				init_vector[k + 8] = static_cast<uint8_t>((seed + len + 1) >> (8 * k));
+			}
+
+			return init_vector;
+		}
+
+		// The 16 bytes of input at offset, with the bytes past its end taken from the initialization vector, like in absorb_partial.
+		constexpr ct_lane_t ct_load_lane(std::string_view input, size_t offset, const ct_lane_t& init_vector)
+		{
+			ct_lane_t lane = init_vector;
+
+			for (size_t k = 0; k < 16 && offset + k < input.size(); k++)
+			{
+				lane[k] = static_cast<uint8_t>(input[offset + k]);
+			}
+
+			return lane;
+		}
+
+		constexpr hash_t<64> meow_hash_ct_impl(std::string_view input, uint64_t seed)
+		{
+			size_t len = input.size();
+			ct_lane_t init_vector = ct_make_init_vector(seed, len);
+
+			std::array<ct_lane_t, 16> streams = {};
+			for (ct_lane_t& stream : streams)
+			{
+				stream = init_vector;
+			}
+
+			for (size_t block = 0; block < len; block += 256)
+			{
+				for (size_t lane = 0; lane < 16; lane++)
+				{
+					streams[lane] = ct_aesdec(streams[lane], ct_load_lane(input, block + lane * 16, init_vector));
+				}
+			}
+
+			// After r rotations, lane k of a stream holds what was originally its lane (k + r) % 4.
+			std::array<ct_lane_t, 4> ret = { init_vector, init_vector, init_vector, init_vector };
+
+			for (size_t rotation = 0; rotation < 4; rotation++)
+			{
+				for (size_t stream = 0; stream < 4; stream++)
+				{
+					for (size_t lane = 0; lane < 4; lane++)
+					{
+						ret[lane] = ct_aesdec(ret[lane], streams[stream * 4 + (lane + rotation) % 4]);
+					}
+				}
+			}
+
+			for (size_t merge = 0; merge < 5; merge++)
+			{
+				for (size_t lane = 0; lane < 4; lane++)
+				{
+					ret[lane] = ct_aesdec(ret[lane], init_vector);
+				}
+			}
+
+			std::array<uint64_t, 8> elem = {};
+
+			for (size_t k = 0; k < 64; k++)
+			{
+				elem[k / 8] |= static_cast<uint64_t>(ret[k / 16][k % 16]) << (8 * (k % 8));
+			}
+
+			return hash_t<64>(elem);
+		}
+	}
+
+	// Gives the same result as meow_hash<N>(input.data(), input.size(), seed), and can be evaluated at compile time.
+	// It's much slower than meow_hash at runtime, so it's meant for constants, such as the keys of lookup tables.
+	constexpr hash_t<64> meow_hash_ct(std::string_view input, uint64_t seed = 0)
+	{
+		return detail::meow_hash_ct_impl(input, seed);
+	}
+
+	namespace literals
+	{
+		constexpr hash_t<64> operator""_meow(const char* str, size_t len)
+		{
+			return detail::meow_hash_ct_impl(std::string_view(str, len), 0);
+		}
+
+		constexpr uint64_t operator""_meow64(const char* str, size_t len)
+		{
+			return detail::meow_hash_ct_impl(std::string_view(str, len), 0)[0];
+		}
+	}
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(_MEOWH_DISPATCH)
+#pragma GCC diagnostic pop
+#endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+#pragma once
+#include "meow_hash_file.hpp"
+
+#include <linux/memfd.h>
+#include <sys/syscall.h>
+
+/* Hashing pipe input on Linux, built on top of meow_hash_file.hpp.
+ * Instead of reading the input into a buffer, it's spliced from the pipe into a memfd that's mapped into memory as a ring,
+ * so the data moves between kernel pages without a copy to user space, and every 256 byte block is hashed in place, from the mapping, as soon as it lands.
+ * Since the length of the input is a part of the initialization vector, it has to be given by the caller, or read from an 8 byte little endian prefix in front of the data.
+ * Input that isn't a pipe, and systems without memfd_create, are read into the ring with read(). */
+
+namespace meowh
+{
+	// Size of the ring that pipe input is spliced into.
+	constexpr size_t meow_pipe_ring_size = 1024 * 1024;
+
+	namespace detail
+	{
+		// A memfd mapped into memory, which input is spliced into. valid() is false if memfd_create isn't available.
+		class memfd_ring
+		{
+		public:
+
+			explicit memfd_ring(size_t size) : file(static_cast<int>(::syscall(__NR_memfd_create, "meowh_pipe", MFD_CLOEXEC))), size(size)
+			{
+				if (file.get() < 0 || ::ftruncate(file.get(), static_cast<off_t>(size)) != 0)
+				{
+					return;
+				}
+
+				void* map = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file.get(), 0);
+
+				if (map != MAP_FAILED)
+				{
+					base = reinterpret_cast<uint8_t*>(map);
+				}
+			}
+
+			memfd_ring(const memfd_ring&) = delete;
+			memfd_ring& operator=(const memfd_ring&) = delete;
+
+			~memfd_ring()
+			{
+				if (base != nullptr)
+				{
+					::munmap(base, size);
+				}
+			}
+
+			bool valid() const
+			{
+				return base != nullptr;
+			}
+
+			int get() const
+			{
+				return file.get();
+			}
+
+			uint8_t* data() const
+			{
+				return base;
+			}
+
+		private:
+
+			file_handle file;
+			size_t size;
+			uint8_t* base = nullptr;
+		};
+	}
+
+	/* Hashes input from pipes, splicing it into a ring of ring_size bytes, rounded up to whole pages. The ring is reused between calls,
+	 * so a single meow_pipe_hasher is meant to hash a whole stream of messages. The results are the same as meow_hash<N, false, R> over the same bytes. */
+	template <size_t N = 128, size_t R = N>
+	class meow_pipe_hasher
+	{
+	public:
+
+		static_assert(N == 128 || N == 256 || N == 512, "meow_pipe_hasher can only be declared in 128, 256, or 512 bit mode.");
+
+		explicit meow_pipe_hasher(size_t ring_size = meow_pipe_ring_size) :
+			ring_size(std::max<size_t>((ring_size + page_size - 1) / page_size, 1) * page_size), ring(this->ring_size)
+		{
+			if (!ring.valid())
+			{
+				fallback.resize(this->ring_size);
+			}
+		}
+
+		// Whether the ring is a memfd that input can be spliced into, rather than memory that it's read into.
+		bool uses_splice() const
+		{
+			return ring.valid();
+		}
+
+		// Hashes the next len bytes of fd, leaving anything after them in the pipe. Throws std::system_error with EIO if the input ends before len bytes.
+		hash_t<R> hash(int fd, uint64_t len, uint64_t seed = 0)
+		{
+			meow_state<N, R> state(len, seed);
+			uint8_t* base = ring.valid() ? ring.data() : fallback.data();
+			bool splice_input = ring.valid();
+
+			uint64_t landed = 0;
+			uint64_t hashed = 0;
+
+			while (landed < len)
+			{
+				// The ring is a whole number of blocks, and is hashed up to its end before wrapping around, so the space up to its end is always free.
+				size_t offset = static_cast<size_t>(landed % ring_size);
+				size_t want = static_cast<size_t>(std::min<uint64_t>(ring_size - offset, len - landed));
+				size_t got = land(fd, base, offset, want, splice_input);
+
+				if (got == 0)
+				{
+					errno = EIO;
+					detail::throw_file_error("meowh::hash_pipe: input ended before the given length");
+				}
+
+				landed += got;
+
+				// Whole blocks are hashed as soon as they land, and a partial block waits for the rest of it, unless it's the end of the input.
+				uint64_t ready = landed == len ? landed - hashed : (landed - hashed) / 256 * 256;
+				state.absorb(base + hashed % ring_size, static_cast<size_t>(ready));
+				hashed += ready;
+			}
+
+			return state.finalize();
+		}
+
+		/* Hashes the next message of fd, framed by its length as an 8 byte little endian integer. Returns false, without hashing,
+		 * if the input ends before the next frame, and throws std::system_error with EIO if it ends in the middle of one. */
+		bool hash_frame(int fd, hash_t<R>& result, uint64_t seed = 0)
+		{
+			uint8_t prefix[8];
+			size_t prefix_len = detail::read_fully(fd, prefix, sizeof(prefix), -1);
+
+			if (prefix_len == 0)
+			{
+				return false;
+			}
+			else if (prefix_len != sizeof(prefix))
+			{
+				errno = EIO;
+				detail::throw_file_error("meowh::hash_pipe: input ended in the length of a frame");
+			}
+
+			uint64_t len = 0;
+
+			for (int k = 0; k < 8; k++)
+			{
+				len |= static_cast<uint64_t>(prefix[k]) << (8 * k);
+			}
+
+			result = hash(fd, len, seed);
+			return true;
+		}
+
+	private:
+
+		static constexpr size_t page_size = 4096;
+
+		// Moves up to len bytes of fd into the ring at offset, returning 0 at the end of the input. Falls back to read() for good once splice turns out not to work with fd.
+		size_t land(int fd, uint8_t* base, size_t offset, size_t len, bool& splice_input)
+		{
+			while (splice_input)
+			{
+				loff_t ring_offset = static_cast<loff_t>(offset);
+				ssize_t ret = ::splice(fd, nullptr, ring.get(), &ring_offset, len, SPLICE_F_MOVE);
+
+				if (ret >= 0)
+				{
+					return static_cast<size_t>(ret);
+				}
+				else if (errno == EINVAL)
+				{
+					splice_input = false;
+				}
+				else if (errno != EINTR)
+				{
+					detail::throw_file_error("meowh::hash_pipe: splice");
+				}
+			}
+
+			return detail::read_fully(fd, base + offset, len, -1);
+		}
+
+		size_t ring_size;
+		detail::memfd_ring ring;
+		std::vector<uint8_t> fallback;
+	};
+
+	// Hashes the next len bytes of fd with a meow_pipe_hasher of its own. For hashing many messages, reusing a meow_pipe_hasher saves setting up the ring each time.
+	template <size_t N = 128, size_t R = N>
+	hash_t<R> hash_pipe(int fd, uint64_t len, uint64_t seed = 0)
+	{
+		return meow_pipe_hasher<N, R>().hash(fd, len, seed);
+	}
+}
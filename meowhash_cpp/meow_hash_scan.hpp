@@ -0,0 +1,258 @@
+#pragma once
+#include "meow_hash_file.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <tuple>
+#include <linux/fiemap.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+
+/* Hashing lists of files in the order of their physical location on the disk, on Linux.
+ * On spinning disks and arrays of them, reading files in the order they were listed makes the heads seek back and forth between them,
+ * so the files are sorted by the physical offset of their first extent, as reported by FIEMAP, and read in that order,
+ * with posix_fadvise readahead issued for the files a few places ahead of the ones being hashed. */
+
+namespace meowh
+{
+	// How many files ahead of the ones being hashed on each device get readahead.
+	constexpr size_t meow_scan_readahead = 8;
+
+	// How much of the start of each of those files is read ahead, so that the readahead of large files is limited to meow_scan_readahead times this.
+	constexpr size_t meow_scan_readahead_bytes = 4 * 1024 * 1024;
+
+	// How many threads read files from each device by default. More readers than this make a disk seek between the files they read at the same time.
+	constexpr unsigned meow_scan_workers_per_device = 2;
+
+	namespace detail
+	{
+		struct scan_entry
+		{
+			size_t index;
+			dev_t device;
+			bool mapped;
+			uint64_t location;
+			int error;
+		};
+
+		// Finds the device and the physical offset of the first extent of a file. Files without extents, like empty or inline ones, are placed by their inode number instead.
+		inline scan_entry locate_file(const std::string& path, size_t index)
+		{
+			scan_entry entry = { index, 0, false, 0, 0 };
+			file_handle file(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+			struct stat file_stat;
+
+			if (file.get() < 0 || ::fstat(file.get(), &file_stat) != 0)
+			{
+				entry.error = errno;
+				return entry;
+			}
+
+			entry.device = file_stat.st_dev;
+			entry.location = static_cast<uint64_t>(file_stat.st_ino);
+
+			// Room for the header and a single extent, which is all that's needed.
+			alignas(fiemap) uint8_t request[sizeof(fiemap) + sizeof(fiemap_extent)] = {};
+			fiemap* map = reinterpret_cast<fiemap*>(request);
+
+			map->fm_start = 0;
+			map->fm_length = FIEMAP_MAX_OFFSET;
+			map->fm_extent_count = 1;
+
+			if (::ioctl(file.get(), FS_IOC_FIEMAP, map) == 0 && map->fm_mapped_extents > 0)
+			{
+				entry.mapped = true;
+				entry.location = map->fm_extents[0].fe_physical;
+			}
+
+			return entry;
+		}
+
+		// Asks for the first meow_scan_readahead_bytes of a file to be read into the page cache, so that large files ahead don't evict the ones being hashed.
+		inline void readahead_file(const std::string& path)
+		{
+			file_handle file(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+
+			if (file.get() >= 0)
+			{
+				::posix_fadvise(file.get(), 0, static_cast<off_t>(meow_scan_readahead_bytes), POSIX_FADV_WILLNEED);
+			}
+		}
+
+		// The entries of one device, from begin to end in the sorted order, and the next one to be hashed.
+		struct scan_device
+		{
+			size_t begin;
+			size_t end;
+			std::atomic<size_t> next;
+		};
+	}
+
+	/* Hashes the files in paths in the order of their physical location, with workers_per_device threads reading from each device the files are on
+	 * (0 for meow_scan_workers_per_device), and calls callback with the index of each file, its hash, and 0, or the errno of the failed operation,
+	 * in which case the hash is unspecified. Each thread only reads from its own device, so a device never has more readers than that, whatever the others do.
+	 * The callback is called on the calling thread, in the order of paths, regardless of the order the files are read in. */
+	template <size_t N = 128, size_t R = N>
+	void hash_files_by_extent(const std::vector<std::string>& paths, const std::function<void(size_t index, const hash_t<R>& hash, int error)>& callback,
+		uint64_t seed = 0, unsigned workers_per_device = 0, size_t readahead = meow_scan_readahead)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "hash_files_by_extent can only be called in 128, 256, or 512 bit mode.");
+
+		std::vector<detail::scan_entry> order;
+		order.reserve(paths.size());
+
+		for (size_t p = 0; p < paths.size(); p++)
+		{
+			order.push_back(detail::locate_file(paths[p], p));
+		}
+
+		// Files are grouped by device, and those without a known physical offset go after the rest of their device.
+		std::stable_sort(order.begin(), order.end(), [](const detail::scan_entry& a, const detail::scan_entry& b)
+		{
+			return std::make_tuple(a.device, !a.mapped, a.location) < std::make_tuple(b.device, !b.mapped, b.location);
+		});
+
+		// Each device gets its own run of entries, with its own cursor.
+		size_t device_count = 0;
+
+		for (size_t k = 0; k < order.size(); k++)
+		{
+			device_count += k == 0 || order[k].device != order[k - 1].device;
+		}
+
+		std::unique_ptr<detail::scan_device[]> devices(new detail::scan_device[device_count]);
+
+		for (size_t k = 0, d = 0; k < order.size(); k++)
+		{
+			if (k == 0 || order[k].device != order[k - 1].device)
+			{
+				devices[d].begin = k;
+				devices[d].next = k;
+				d++;
+			}
+			devices[d - 1].end = k + 1;
+		}
+
+		std::vector<hash_t<R>> hashes(paths.size());
+		std::vector<int> errors(paths.size(), 0);
+		std::vector<char> done(paths.size(), 0);
+
+		std::mutex lock;
+		std::condition_variable progress;
+
+		auto worker = [&](detail::scan_device& device)
+		{
+			for (size_t k = device.next.fetch_add(1); k < device.end; k = device.next.fetch_add(1))
+			{
+				if (readahead > 0 && k + readahead < device.end && order[k + readahead].error == 0)
+				{
+					detail::readahead_file(paths[order[k + readahead].index]);
+				}
+
+				const detail::scan_entry& entry = order[k];
+				hash_t<R> hash(std::array<hash_type_t<R>, 512 / R>{});
+				int error = entry.error;
+
+				if (error == 0)
+				{
+					try
+					{
+						hash = hash_file<N, R>(paths[entry.index], seed);
+					}
+					catch (const std::system_error& e)
+					{
+						error = e.code().value();
+					}
+				}
+
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					hashes[entry.index] = hash;
+					errors[entry.index] = error;
+					done[entry.index] = 1;
+				}
+				progress.notify_one();
+			}
+		};
+
+		if (workers_per_device == 0)
+		{
+			workers_per_device = meow_scan_workers_per_device;
+		}
+
+		// The first files of every device get their readahead before any of them is hashed.
+		for (size_t d = 0; d < device_count; d++)
+		{
+			for (size_t k = devices[d].begin; k < std::min(devices[d].begin + readahead, devices[d].end); k++)
+			{
+				if (order[k].error == 0)
+				{
+					detail::readahead_file(paths[order[k].index]);
+				}
+			}
+		}
+
+		std::vector<std::thread> workers;
+		std::vector<char> served(device_count, 0);
+		workers.reserve(device_count * workers_per_device);
+
+		try
+		{
+			for (unsigned w = 0; w < workers_per_device; w++)
+			{
+				for (size_t d = 0; d < device_count; d++)
+				{
+					workers.emplace_back(worker, std::ref(devices[d]));
+					served[d] = 1;
+				}
+			}
+		}
+		catch (const std::system_error&)
+		{
+			// Fewer threads are used if the system can't start them all.
+		}
+
+		// The files of devices that no thread could be started for are hashed here, before the results are reported.
+		for (size_t d = 0; d < device_count; d++)
+		{
+			if (!served[d])
+			{
+				worker(devices[d]);
+			}
+		}
+
+		try
+		{
+			for (size_t p = 0; p < paths.size(); p++)
+			{
+				{
+					std::unique_lock<std::mutex> guard(lock);
+					progress.wait(guard, [&]() { return done[p] != 0; });
+				}
+
+				callback(p, hashes[p], errors[p]);
+			}
+		}
+		catch (...)
+		{
+			// The workers stop after the files they're hashing, if the callback throws.
+			for (size_t d = 0; d < device_count; d++)
+			{
+				devices[d].next = devices[d].end;
+			}
+
+			for (std::thread& thread : workers)
+			{
+				thread.join();
+			}
+			throw;
+		}
+
+		for (std::thread& thread : workers)
+		{
+			thread.join();
+		}
+	}
+}
@@ -0,0 +1,858 @@
+#pragma once
+#include "meow_hash_file.hpp"
+
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+/* Batch file hashing on Linux, built on top of meow_hash_file.hpp.
+ * Reads are submitted through io_uring, with the raw system calls, so no liburing is needed, into a fixed pool of registered buffers,
+ * and the buffers are hashed on worker threads while the next reads are in flight. On kernels without io_uring, or where it's disabled,
+ * the same pipeline runs with blocking preads instead. */
+
+namespace meowh
+{
+	namespace detail
+	{
+		inline int uring_setup(unsigned entries, io_uring_params* params)
+		{
+			return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+		}
+
+		inline int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+		{
+			return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+		}
+
+		inline int uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args)
+		{
+			return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+		}
+
+		// Page aligned buffers, which are also what O_DIRECT reads need.
+		constexpr size_t buffer_alignment = 4096;
+
+		struct free_deleter
+		{
+			void operator()(uint8_t* ptr) const
+			{
+				std::free(ptr);
+			}
+		};
+
+		using aligned_buffer = std::unique_ptr<uint8_t, free_deleter>;
+
+		inline aligned_buffer allocate_aligned(size_t size)
+		{
+			aligned_buffer buffer(reinterpret_cast<uint8_t*>(std::aligned_alloc(buffer_alignment, (size + buffer_alignment - 1) / buffer_alignment * buffer_alignment)));
+
+			if (!buffer)
+			{
+				throw std::bad_alloc();
+			}
+
+			return buffer;
+		}
+
+		// The submission and completion queues of an io_uring instance, mapped into memory. valid() is false if io_uring isn't available.
+		class uring
+		{
+		public:
+
+			explicit uring(unsigned entries)
+			{
+				io_uring_params params = {};
+				fd = uring_setup(entries, &params);
+
+				if (fd < 0)
+				{
+					return;
+				}
+
+				sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+				cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+				sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+				if (params.features & IORING_FEAT_SINGLE_MMAP)
+				{
+					sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+				}
+
+				sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+				cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP) ? sq_ring :
+					::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+				sqes = reinterpret_cast<io_uring_sqe*>(::mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+
+				if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED)
+				{
+					release();
+					return;
+				}
+
+				uint8_t* sq = reinterpret_cast<uint8_t*>(sq_ring);
+				uint8_t* cq = reinterpret_cast<uint8_t*>(cq_ring);
+
+				sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+				sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+				sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+				cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+				cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+				cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+				cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+			}
+
+			uring(const uring&) = delete;
+			uring& operator=(const uring&) = delete;
+
+			~uring()
+			{
+				release();
+			}
+
+			bool valid() const
+			{
+				return fd >= 0;
+			}
+
+			int get() const
+			{
+				return fd;
+			}
+
+			// Returns the next free submission queue entry, cleared. The caller has to keep the number of unsubmitted and in flight requests within the queue size.
+			io_uring_sqe* next_sqe()
+			{
+				unsigned index = (*sq_tail + pending) & sq_mask;
+				pending++;
+
+				io_uring_sqe* sqe = &sqes[index];
+				std::memset(sqe, 0, sizeof(io_uring_sqe));
+				sq_array[index] = index;
+				return sqe;
+			}
+
+			// Submits the pending entries and waits for at least min_complete completions.
+			void submit_and_wait(unsigned min_complete)
+			{
+				__atomic_store_n(sq_tail, *sq_tail + pending, __ATOMIC_RELEASE);
+
+				unsigned to_submit = pending;
+				pending = 0;
+
+				while (true)
+				{
+					int ret = uring_enter(fd, to_submit, min_complete, min_complete > 0 ? IORING_ENTER_GETEVENTS : 0);
+
+					if (ret >= 0)
+					{
+						to_submit -= std::min<unsigned>(to_submit, static_cast<unsigned>(ret));
+
+						if (to_submit == 0)
+						{
+							return;
+						}
+					}
+					else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+					{
+						throw_file_error("meowh::meow_uring_engine: io_uring_enter");
+					}
+				}
+			}
+
+			// Calls f(user_data, res) for every completion that's available, without waiting.
+			template <typename F>
+			void reap(F&& f)
+			{
+				unsigned head = *cq_head;
+				unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+
+				while (head != tail)
+				{
+					const io_uring_cqe& cqe = cqes[head & cq_mask];
+					f(cqe.user_data, cqe.res);
+					head++;
+				}
+
+				__atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+			}
+
+		private:
+
+			void release()
+			{
+				if (sqes != nullptr && sqes != MAP_FAILED)
+				{
+					::munmap(sqes, sqes_size);
+				}
+				if (cq_ring != nullptr && cq_ring != MAP_FAILED && cq_ring != sq_ring)
+				{
+					::munmap(cq_ring, cq_ring_size);
+				}
+				if (sq_ring != nullptr && sq_ring != MAP_FAILED)
+				{
+					::munmap(sq_ring, sq_ring_size);
+				}
+				if (fd >= 0)
+				{
+					::close(fd);
+				}
+
+				fd = -1;
+				sq_ring = cq_ring = nullptr;
+				sqes = nullptr;
+			}
+
+			int fd = -1;
+			unsigned pending = 0;
+
+			void* sq_ring = nullptr;
+			void* cq_ring = nullptr;
+			io_uring_sqe* sqes = nullptr;
+			size_t sq_ring_size = 0;
+			size_t cq_ring_size = 0;
+			size_t sqes_size = 0;
+
+			unsigned* sq_tail = nullptr;
+			unsigned sq_mask = 0;
+			unsigned* sq_array = nullptr;
+
+			unsigned* cq_head = nullptr;
+			unsigned* cq_tail = nullptr;
+			unsigned cq_mask = 0;
+			io_uring_cqe* cqes = nullptr;
+		};
+
+		/* Waits for the in_flight reads of a ring when it goes out of scope, however that happens, since the kernel keeps writing into their buffers
+		 * until they complete, and the buffers can't be freed or reused before that. If waiting fails, the buffers are leaked instead. */
+		class uring_drain
+		{
+		public:
+
+			uring_drain(uring& ring, size_t& in_flight, aligned_buffer& buffers) : ring(ring), in_flight(in_flight), buffers(buffers) {}
+
+			uring_drain(const uring_drain&) = delete;
+			uring_drain& operator=(const uring_drain&) = delete;
+
+			~uring_drain()
+			{
+				while (in_flight > 0 && ring.valid())
+				{
+					try
+					{
+						ring.submit_and_wait(1);
+					}
+					catch (const std::system_error&)
+					{
+						buffers.release();
+						return;
+					}
+
+					ring.reap([this](uint64_t, int32_t) { in_flight--; });
+				}
+			}
+
+		private:
+
+			uring& ring;
+			size_t& in_flight;
+			aligned_buffer& buffers;
+		};
+	}
+
+	/* Hashes large numbers of files, keeping up to queue_depth reads in flight on each device, with every read going into one of buffer_count
+	 * buffers of buffer_size bytes that are registered with the kernel once. Each file has at most one read in flight at a time, so that its
+	 * chunks are absorbed in order, and the completed buffers are hashed on worker_count threads. The results are the same as hash_file<N, R>. */
+	template <size_t N = 128, size_t R = N>
+	class meow_uring_engine
+	{
+	public:
+
+		static_assert(N == 128 || N == 256 || N == 512, "meow_uring_engine can only be declared in 128, 256, or 512 bit mode.");
+
+		/* Called with the index of the file in the list passed to hash_files, its hash, and 0, or the errno of the failed operation, in which case the hash is unspecified.
+		 * It's called from the worker threads, and from the thread that called hash_files for files that couldn't be read, so it has to be thread safe. */
+		using callback_t = std::function<void(size_t index, const hash_t<R>& hash, int error)>;
+
+		explicit meow_uring_engine(unsigned queue_depth = 32, unsigned buffer_count = 64, size_t buffer_size = 256 * 1024, unsigned worker_count = 2) :
+			queue_depth(std::max(queue_depth, 1u)), buffer_count(std::max(buffer_count, 1u)),
+			buffer_size(std::max<size_t>((buffer_size + buffer_alignment - 1) / buffer_alignment, 1) * buffer_alignment),
+			worker_count(std::max(worker_count, 1u)), ring(this->buffer_count), slots(this->buffer_count)
+		{
+			buffers = detail::allocate_aligned(this->buffer_count * this->buffer_size);
+
+			std::vector<iovec> iovecs(this->buffer_count);
+
+			for (unsigned b = 0; b < this->buffer_count; b++)
+			{
+				slots[b].buffer.iov_base = buffers.get() + b * this->buffer_size;
+				slots[b].buffer.iov_len = this->buffer_size;
+				iovecs[b] = slots[b].buffer;
+			}
+
+			// Registration can fail when the buffers exceed RLIMIT_MEMLOCK, in which case plain reads are used.
+			registered = ring.valid() && detail::uring_register(ring.get(), IORING_REGISTER_BUFFERS, iovecs.data(), this->buffer_count) == 0;
+		}
+
+		// Whether reads go through io_uring rather than blocking preads.
+		bool uses_io_uring() const
+		{
+			return ring.valid();
+		}
+
+		void hash_files(const std::vector<std::string>& paths, const callback_t& callback, uint64_t seed = 0)
+		{
+			batch current(paths, callback, seed);
+			run(current);
+		}
+
+	private:
+
+		static constexpr size_t buffer_alignment = detail::buffer_alignment;
+
+		struct file_job
+		{
+			size_t index;
+			detail::file_handle file;
+			dev_t device;
+			uint64_t size;
+			uint64_t offset;
+			std::unique_ptr<meow_state<N, R>> state;
+
+			file_job(size_t index, int fd) : index(index), file(fd), device(0), size(0), offset(0) {}
+		};
+
+		struct read_slot
+		{
+			iovec buffer;
+			iovec remaining;
+			file_job* job = nullptr;
+			size_t len = 0;
+			size_t filled = 0;
+			int error = 0;
+		};
+
+		struct batch
+		{
+			const std::vector<std::string>& paths;
+			const callback_t& callback;
+			uint64_t seed;
+
+			size_t next_path = 0;
+			size_t active = 0;
+			size_t in_flight = 0;
+
+			std::vector<unsigned> free_slots;
+			std::map<size_t, std::unique_ptr<file_job>> jobs;
+			std::deque<file_job*> ready;
+			std::unordered_map<dev_t, unsigned> device_in_flight;
+
+			// Shared with the workers, guarded by lock.
+			std::mutex lock;
+			std::condition_variable work_available;
+			std::condition_variable slots_returned;
+			std::deque<unsigned> completed;
+			std::vector<unsigned> returned;
+			bool stop = false;
+
+			batch(const std::vector<std::string>& paths, const callback_t& callback, uint64_t seed) : paths(paths), callback(callback), seed(seed) {}
+		};
+
+		void run(batch& current)
+		{
+			for (unsigned b = 0; b < buffer_count; b++)
+			{
+				current.free_slots.push_back(b);
+			}
+
+			// Destroyed after the workers are stopped, and before the batch and its jobs, so that nothing is freed while the kernel is still reading into it.
+			detail::uring_drain drain(ring, current.in_flight, buffers);
+
+			std::vector<std::thread> workers;
+			workers.reserve(worker_count);
+
+			try
+			{
+				for (unsigned w = 0; w < worker_count; w++)
+				{
+					workers.emplace_back(&meow_uring_engine::worker, this, std::ref(current));
+				}
+
+				drive(current);
+			}
+			catch (...)
+			{
+				stop_workers(current, workers);
+				throw;
+			}
+
+			stop_workers(current, workers);
+		}
+
+		void stop_workers(batch& current, std::vector<std::thread>& workers)
+		{
+			{
+				std::lock_guard<std::mutex> guard(current.lock);
+				current.stop = true;
+			}
+			current.work_available.notify_all();
+
+			for (std::thread& worker : workers)
+			{
+				worker.join();
+			}
+		}
+
+		// The loop of the thread that called hash_files, which opens the files, submits the reads, and hands completed buffers over to the workers.
+		void drive(batch& current)
+		{
+			while (current.next_path < current.paths.size() || current.active > 0)
+			{
+				collect_returned(current);
+				open_files(current);
+				submit_reads(current);
+
+				if (current.in_flight > 0 && ring.valid())
+				{
+					ring.submit_and_wait(1);
+					ring.reap([this, &current](uint64_t user_data, int32_t res) { complete_read(current, static_cast<unsigned>(user_data), res); });
+				}
+				else if (current.active > 0)
+				{
+					// Everything that's left is either being hashed, or waiting for a buffer that's being hashed.
+					std::unique_lock<std::mutex> guard(current.lock);
+					current.slots_returned.wait(guard, [&current]() { return !current.returned.empty(); });
+				}
+			}
+		}
+
+		void collect_returned(batch& current)
+		{
+			std::vector<unsigned> returned;
+			{
+				std::lock_guard<std::mutex> guard(current.lock);
+				returned.swap(current.returned);
+			}
+
+			for (unsigned s : returned)
+			{
+				read_slot& slot = slots[s];
+				file_job* job = slot.job;
+				slot.job = nullptr;
+
+				current.free_slots.push_back(s);
+
+				if (job->offset < job->size)
+				{
+					current.ready.push_back(job);
+				}
+				else
+				{
+					finish_job(current, job);
+				}
+			}
+		}
+
+		// Opens files as long as there are fewer of them waiting to be read than free buffers, so that the number of open files stays bounded.
+		void open_files(batch& current)
+		{
+			while (current.next_path < current.paths.size() && current.ready.size() < current.free_slots.size())
+			{
+				size_t index = current.next_path++;
+				std::unique_ptr<file_job> job(new file_job(index, ::open(current.paths[index].c_str(), O_RDONLY | O_CLOEXEC)));
+
+				struct stat file_stat;
+
+				if (job->file.get() < 0 || ::fstat(job->file.get(), &file_stat) != 0)
+				{
+					current.callback(index, hash_t<R>(), errno);
+					continue;
+				}
+
+				if (!S_ISREG(file_stat.st_mode) || file_stat.st_size == 0)
+				{
+					// Special files have no known length, so they're read to their end right away, as hash_file does.
+					try
+					{
+						current.callback(index, detail::hash_file_stream<N, R>(job->file.get(), current.seed), 0);
+					}
+					catch (const std::system_error& e)
+					{
+						current.callback(index, hash_t<R>(), e.code().value());
+					}
+					continue;
+				}
+
+				job->device = file_stat.st_dev;
+				job->size = static_cast<uint64_t>(file_stat.st_size);
+
+				if (job->size > buffer_size)
+				{
+					job->state.reset(new meow_state<N, R>(job->size, current.seed));
+				}
+
+				current.ready.push_back(job.get());
+				current.jobs[index] = std::move(job);
+				current.active++;
+			}
+		}
+
+		void submit_reads(batch& current)
+		{
+			size_t ready_count = current.ready.size();
+
+			for (size_t r = 0; r < ready_count && !current.free_slots.empty(); r++)
+			{
+				file_job* job = current.ready.front();
+				current.ready.pop_front();
+
+				unsigned& device_in_flight = current.device_in_flight[job->device];
+
+				if (device_in_flight >= queue_depth)
+				{
+					current.ready.push_back(job);
+					continue;
+				}
+
+				unsigned s = current.free_slots.back();
+				current.free_slots.pop_back();
+				device_in_flight++;
+
+				read_slot& slot = slots[s];
+				slot.job = job;
+				slot.len = static_cast<size_t>(std::min<uint64_t>(job->size - job->offset, buffer_size));
+				slot.filled = 0;
+				slot.error = 0;
+
+				submit_read(current, s);
+			}
+		}
+
+		void submit_read(batch& current, unsigned s)
+		{
+			read_slot& slot = slots[s];
+			uint8_t* dst = reinterpret_cast<uint8_t*>(slot.buffer.iov_base) + slot.filled;
+			uint64_t offset = slot.job->offset + slot.filled;
+
+			current.in_flight++;
+
+			if (!ring.valid())
+			{
+				ssize_t ret = ::pread(slot.job->file.get(), dst, slot.len - slot.filled, static_cast<off_t>(offset));
+				complete_read(current, s, ret < 0 ? -errno : static_cast<int32_t>(ret));
+				return;
+			}
+
+			io_uring_sqe* sqe = ring.next_sqe();
+			sqe->fd = slot.job->file.get();
+			sqe->off = offset;
+			sqe->user_data = s;
+
+			if (registered)
+			{
+				sqe->opcode = IORING_OP_READ_FIXED;
+				sqe->addr = reinterpret_cast<uint64_t>(dst);
+				sqe->len = static_cast<uint32_t>(slot.len - slot.filled);
+				sqe->buf_index = static_cast<uint16_t>(s);
+			}
+			else
+			{
+				slot.remaining = { dst, slot.len - slot.filled };
+				sqe->opcode = IORING_OP_READV;
+				sqe->addr = reinterpret_cast<uint64_t>(&slot.remaining);
+				sqe->len = 1;
+			}
+		}
+
+		void complete_read(batch& current, unsigned s, int32_t res)
+		{
+			read_slot& slot = slots[s];
+			current.in_flight--;
+
+			if (res == -EINTR || res == -EAGAIN)
+			{
+				submit_read(current, s);
+				return;
+			}
+
+			if (res <= 0)
+			{
+				// A read returning nothing before the size reported by fstat means that the file shrank while being hashed.
+				file_job* job = slot.job;
+				slot.job = nullptr;
+
+				current.free_slots.push_back(s);
+				current.device_in_flight[job->device]--;
+				current.callback(job->index, hash_t<R>(), res < 0 ? -res : EIO);
+				current.jobs.erase(job->index);
+				current.active--;
+				return;
+			}
+
+			slot.filled += static_cast<size_t>(res);
+
+			if (slot.filled < slot.len)
+			{
+				submit_read(current, s);
+				return;
+			}
+
+			// The device is free for another read as soon as this one is done, while the buffer is being hashed.
+			current.device_in_flight[slot.job->device]--;
+
+			{
+				std::lock_guard<std::mutex> guard(current.lock);
+				current.completed.push_back(s);
+			}
+			current.work_available.notify_one();
+		}
+
+		void finish_job(batch& current, file_job* job)
+		{
+			current.jobs.erase(job->index);
+			current.active--;
+		}
+
+		// Hashes completed buffers, and reports the files whose last chunk they hold.
+		void worker(batch& current)
+		{
+			while (true)
+			{
+				unsigned s;
+				{
+					std::unique_lock<std::mutex> guard(current.lock);
+					current.work_available.wait(guard, [&current]() { return current.stop || !current.completed.empty(); });
+
+					if (current.completed.empty())
+					{
+						return;
+					}
+
+					s = current.completed.front();
+					current.completed.pop_front();
+				}
+
+				read_slot& slot = slots[s];
+				file_job* job = slot.job;
+				const uint8_t* data = reinterpret_cast<const uint8_t*>(slot.buffer.iov_base);
+
+				job->offset += slot.len;
+
+				if (!job->state)
+				{
+					current.callback(job->index, detail::meow_hash_impl<N, false, R>(data, slot.len, current.seed), 0);
+				}
+				else
+				{
+					job->state->absorb(data, slot.len);
+
+					if (job->offset == job->size)
+					{
+						current.callback(job->index, job->state->finalize(), 0);
+					}
+				}
+
+				{
+					std::lock_guard<std::mutex> guard(current.lock);
+					current.returned.push_back(s);
+				}
+				current.slots_returned.notify_one();
+			}
+		}
+
+		unsigned queue_depth;
+		unsigned buffer_count;
+		size_t buffer_size;
+		unsigned worker_count;
+
+		detail::uring ring;
+		bool registered = false;
+
+		detail::aligned_buffer buffers;
+		std::vector<read_slot> slots;
+	};
+
+	// Size of the reads, and the number of them kept in flight, by hash_file_direct.
+	constexpr size_t meow_direct_chunk_size = 1024 * 1024;
+	constexpr unsigned meow_direct_queue_depth = 4;
+
+	/* Hashes a file with O_DIRECT reads, which bypass the page cache, so that hashing a large cold file doesn't evict the cache of everything else running on the machine.
+	 * Up to queue_depth consecutive chunks are read at once through io_uring, into page aligned buffers that are hashed with the Align = true path, and absorbed in order.
+	 * The tail of the file is read with a length rounded up to the page size, which O_DIRECT requires, and the read stops short at the end of the file.
+	 * On file systems without O_DIRECT support, and for special files, this falls back to hash_file. The results are the same as hash_file<N, R>. */
+	template <size_t N = 128, size_t R = N>
+	hash_t<R> hash_file_direct(const char* path, uint64_t seed = 0, unsigned queue_depth = meow_direct_queue_depth)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "hash_file_direct can only be called in 128, 256, or 512 bit mode.");
+
+		detail::file_handle file(::open(path, O_RDONLY | O_CLOEXEC | O_DIRECT));
+
+		if (file.get() < 0)
+		{
+			if (errno == EINVAL)
+			{
+				return hash_file<N, R>(path, seed);
+			}
+			detail::throw_file_error("meowh::hash_file_direct: open");
+		}
+
+		struct stat file_stat;
+
+		if (::fstat(file.get(), &file_stat) != 0)
+		{
+			detail::throw_file_error("meowh::hash_file_direct: fstat");
+		}
+
+		if (!S_ISREG(file_stat.st_mode) || file_stat.st_size == 0)
+		{
+			return hash_file<N, R>(path, seed);
+		}
+
+		uint64_t size = static_cast<uint64_t>(file_stat.st_size);
+		uint64_t chunk_count = (size + meow_direct_chunk_size - 1) / meow_direct_chunk_size;
+
+		queue_depth = static_cast<unsigned>(std::min<uint64_t>(std::max(queue_depth, 1u), chunk_count));
+
+		detail::aligned_buffer buffers = detail::allocate_aligned(queue_depth * meow_direct_chunk_size);
+		detail::uring ring(queue_depth);
+
+		std::vector<size_t> filled(queue_depth, 0);
+		std::vector<iovec> iovecs(queue_depth);
+		size_t in_flight = 0;
+		int error = 0;
+
+		// Destroyed before the ring and the buffers, whether the hashing finishes, fails, or throws.
+		detail::uring_drain drain(ring, in_flight, buffers);
+
+		auto chunk_data = [&](uint64_t chunk) { return buffers.get() + (chunk % queue_depth) * meow_direct_chunk_size; };
+		auto chunk_len = [&](uint64_t chunk) { return static_cast<size_t>(std::min<uint64_t>(size - chunk * meow_direct_chunk_size, meow_direct_chunk_size)); };
+
+		// O_DIRECT reads have to cover whole pages, so the read of the tail is rounded up, and returns only the bytes up to the end of the file.
+		auto read_len = [&](uint64_t chunk) { return (chunk_len(chunk) + detail::buffer_alignment - 1) / detail::buffer_alignment * detail::buffer_alignment; };
+
+		auto submit = [&](uint64_t chunk)
+		{
+			size_t slot = static_cast<size_t>(chunk % queue_depth);
+			iovecs[slot] = { chunk_data(chunk) + filled[slot], read_len(chunk) - filled[slot] };
+
+			io_uring_sqe* sqe = ring.next_sqe();
+			sqe->opcode = IORING_OP_READV;
+			sqe->fd = file.get();
+			sqe->off = chunk * meow_direct_chunk_size + filled[slot];
+			sqe->addr = reinterpret_cast<uint64_t>(&iovecs[slot]);
+			sqe->len = 1;
+			sqe->user_data = chunk;
+			in_flight++;
+		};
+
+		auto complete = [&](uint64_t chunk, int32_t res)
+		{
+			size_t slot = static_cast<size_t>(chunk % queue_depth);
+			in_flight--;
+
+			if (res == -EINTR || res == -EAGAIN)
+			{
+				submit(chunk);
+				return;
+			}
+			else if (res <= 0)
+			{
+				// Nothing read before the size reported by fstat means the file shrank while being hashed.
+				error = res < 0 ? -res : EIO;
+				return;
+			}
+
+			filled[slot] += static_cast<size_t>(res);
+
+			if (filled[slot] < chunk_len(chunk) && error == 0)
+			{
+				submit(chunk);
+			}
+		};
+
+		auto read_chunk = [&](uint64_t chunk)
+		{
+			size_t slot = static_cast<size_t>(chunk % queue_depth);
+
+			while (filled[slot] < chunk_len(chunk))
+			{
+				ssize_t ret = ::pread(file.get(), chunk_data(chunk) + filled[slot], read_len(chunk) - filled[slot], static_cast<off_t>(chunk * meow_direct_chunk_size + filled[slot]));
+
+				if (ret < 0 && errno == EINTR)
+				{
+					continue;
+				}
+				else if (ret <= 0)
+				{
+					errno = ret < 0 ? errno : EIO;
+					detail::throw_file_error("meowh::hash_file_direct: read");
+				}
+
+				filled[slot] += static_cast<size_t>(ret);
+			}
+		};
+
+		if (chunk_count == 1)
+		{
+			read_chunk(0);
+			return detail::meow_hash_impl<N, true, R>(buffers.get(), size, seed);
+		}
+
+		meow_state<N, R> state(size, seed);
+		uint64_t next_submit = 0;
+
+		if (ring.valid())
+		{
+			for (; next_submit < queue_depth; next_submit++)
+			{
+				submit(next_submit);
+			}
+		}
+
+		for (uint64_t chunk = 0; chunk < chunk_count && error == 0; chunk++)
+		{
+			size_t slot = static_cast<size_t>(chunk % queue_depth);
+
+			if (!ring.valid())
+			{
+				read_chunk(chunk);
+			}
+
+			// Completions can arrive in any order, but the chunks are absorbed in the order of the file.
+			while (filled[slot] < chunk_len(chunk) && error == 0)
+			{
+				ring.submit_and_wait(1);
+				ring.reap(complete);
+			}
+
+			if (error != 0)
+			{
+				break;
+			}
+
+			state.absorb(chunk_data(chunk), chunk_len(chunk));
+			filled[slot] = 0;
+
+			if (ring.valid() && next_submit < chunk_count)
+			{
+				submit(next_submit++);
+			}
+		}
+
+		if (error != 0)
+		{
+			errno = error;
+			detail::throw_file_error("meowh::hash_file_direct: read");
+		}
+
+		return state.finalize();
+	}
+}
@@ -0,0 +1,668 @@
+#pragma once
+#include "meow_hash_file.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+/* Digests of directory trees on Linux, built on top of meow_hash_file.hpp, kept up to date with inotify.
+ * The digest of a file is its hash_file, the digest of a symbolic link is the hash of its target, and the digest of a directory is the hash of the list
+ * of its entries, sorted by name, each as its type, name and digest, so changing a file only changes the digests of the directories above it.
+ * meow_directory_watcher builds the tree once, then watches every directory in it, and after each burst of changes re-hashes only the entries that changed,
+ * and the directories on the path from them to the root, so the digest of the whole tree is always at hand. Entries that can't be read are left out.
+ * Directories that can't be watched, for example once the inotify watch limit is reached, are scanned again in full with every change, and every meow_watch_rescan. */
+
+namespace meowh
+{
+	// How long the tree has to stay quiet after a change before the changes are applied.
+	constexpr std::chrono::milliseconds meow_watch_coalesce(50);
+
+	// How often the directories that couldn't be watched are scanned again, when nothing else changes.
+	constexpr std::chrono::milliseconds meow_watch_rescan(1000);
+
+	namespace detail
+	{
+		constexpr uint32_t watch_mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+		template <size_t R>
+		struct tree_node
+		{
+			enum class kind : uint8_t { file = 'f', symlink = 'l', directory = 'd' };
+
+			kind type;
+			tree_node* parent;
+			std::string name;
+			std::map<std::string, std::unique_ptr<tree_node>> children;
+			hash_t<R> digest;
+			int watch = -1;
+			bool stale = true;
+		};
+
+		template <size_t R>
+		std::string node_path(const std::string& root, const tree_node<R>* node)
+		{
+			std::string path;
+
+			for (; node->parent != nullptr; node = node->parent)
+			{
+				path.insert(0, "/" + node->name);
+			}
+
+			return root + path;
+		}
+
+		// Marks the node and the directories above it to be hashed again.
+		template <size_t R>
+		void mark_stale(tree_node<R>* node)
+		{
+			for (; node != nullptr; node = node->parent)
+			{
+				node->stale = true;
+			}
+		}
+
+		/* Fills in the entries of a directory node, and of the directories below it, adding the files and symbolic links to files.
+		 * With an inotify descriptor, each directory is watched before it's read, so nothing created while it's being read is missed,
+		 * and the directories that can't be watched are added to unwatched. */
+		template <size_t R>
+		void scan_directory(const std::string& path, tree_node<R>* node, std::vector<tree_node<R>*>& files, int inotify_fd, std::map<int, tree_node<R>*>* watches,
+			std::set<tree_node<R>*>* unwatched)
+		{
+			if (inotify_fd >= 0)
+			{
+				node->watch = ::inotify_add_watch(inotify_fd, path.c_str(), watch_mask);
+
+				if (node->watch >= 0)
+				{
+					(*watches)[node->watch] = node;
+				}
+				else
+				{
+					unwatched->insert(node);
+				}
+			}
+
+			DIR* dir = ::opendir(path.c_str());
+
+			if (dir == nullptr)
+			{
+				return;
+			}
+
+			for (dirent* entry = ::readdir(dir); entry != nullptr; entry = ::readdir(dir))
+			{
+				std::string name = entry->d_name;
+				struct stat entry_stat;
+
+				if (name == "." || name == ".." || ::fstatat(::dirfd(dir), name.c_str(), &entry_stat, AT_SYMLINK_NOFOLLOW) != 0)
+				{
+					continue;
+				}
+
+				std::unique_ptr<tree_node<R>> child(new tree_node<R>());
+				child->parent = node;
+				child->name = name;
+
+				if (S_ISDIR(entry_stat.st_mode))
+				{
+					child->type = tree_node<R>::kind::directory;
+					scan_directory(path + "/" + name, child.get(), files, inotify_fd, watches, unwatched);
+				}
+				else if (S_ISREG(entry_stat.st_mode) || S_ISLNK(entry_stat.st_mode))
+				{
+					child->type = S_ISREG(entry_stat.st_mode) ? tree_node<R>::kind::file : tree_node<R>::kind::symlink;
+					files.push_back(child.get());
+				}
+				else
+				{
+					continue;
+				}
+
+				node->children[name] = std::move(child);
+			}
+
+			::closedir(dir);
+		}
+
+		// Hashes the files and symbolic links on worker_count threads, and removes the ones that couldn't be read from the tree.
+		template <size_t N, size_t R>
+		void hash_nodes(const std::string& root, const std::vector<tree_node<R>*>& files, uint64_t seed, unsigned worker_count)
+		{
+			std::vector<char> failed(files.size(), 0);
+			std::atomic<size_t> next(0);
+
+			auto worker = [&]()
+			{
+				for (size_t k = next.fetch_add(1); k < files.size(); k = next.fetch_add(1))
+				{
+					std::string path = node_path(root, files[k]);
+
+					try
+					{
+						if (files[k]->type == tree_node<R>::kind::file)
+						{
+							files[k]->digest = hash_file<N, R>(path, seed);
+						}
+						else
+						{
+							char target[4096];
+							ssize_t len = ::readlink(path.c_str(), target, sizeof(target));
+
+							if (len < 0)
+							{
+								throw_file_error("meowh::hash_directory: readlink");
+							}
+
+							files[k]->digest = meow_hash_impl<N, false, R>(reinterpret_cast<const uint8_t*>(target), static_cast<uint64_t>(len), seed);
+						}
+					}
+					catch (const std::system_error&)
+					{
+						failed[k] = 1;
+					}
+				}
+			};
+
+			std::vector<std::thread> workers;
+
+			for (unsigned w = 1; w < worker_count && w < files.size(); w++)
+			{
+				try
+				{
+					workers.emplace_back(worker);
+				}
+				catch (const std::system_error&)
+				{
+					break;
+				}
+			}
+
+			worker();
+
+			for (std::thread& thread : workers)
+			{
+				thread.join();
+			}
+
+			for (size_t k = 0; k < files.size(); k++)
+			{
+				mark_stale(files[k]->parent);
+
+				if (failed[k])
+				{
+					files[k]->parent->children.erase(files[k]->name);
+				}
+			}
+		}
+
+		// Hashes the stale directories again, from the bottom up, skipping every subtree that didn't change.
+		template <size_t N, size_t R>
+		void update_digests(tree_node<R>* node, uint64_t seed)
+		{
+			if (!node->stale || node->type != tree_node<R>::kind::directory)
+			{
+				return;
+			}
+
+			std::vector<uint8_t> listing;
+
+			for (auto& child : node->children)
+			{
+				update_digests<N, R>(child.second.get(), seed);
+
+				listing.push_back(static_cast<uint8_t>(child.second->type));
+				listing.insert(listing.end(), child.first.begin(), child.first.end());
+				listing.push_back(0);
+
+				const uint8_t* digest = reinterpret_cast<const uint8_t*>(child.second->digest.elem.data());
+				listing.insert(listing.end(), digest, digest + 64);
+			}
+
+			node->digest = meow_hash_impl<N, false, R>(listing.data(), listing.size(), seed);
+			node->stale = false;
+		}
+
+		inline unsigned default_worker_count(unsigned worker_count)
+		{
+			return worker_count == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : worker_count;
+		}
+	}
+
+	/* Hashes the directory tree at path, on worker_count threads (0 for std::thread::hardware_concurrency()), giving the same digest as meow_directory_watcher.
+	 * Throws std::system_error if path isn't a readable directory. */
+	template <size_t N = 128, size_t R = N>
+	hash_t<R> hash_directory(const std::string& path, uint64_t seed = 0, unsigned worker_count = 0)
+	{
+		static_assert(N == 128 || N == 256 || N == 512, "hash_directory can only be called in 128, 256, or 512 bit mode.");
+
+		DIR* dir = ::opendir(path.c_str());
+
+		if (dir == nullptr)
+		{
+			detail::throw_file_error("meowh::hash_directory: opendir");
+		}
+		::closedir(dir);
+
+		detail::tree_node<R> root;
+		root.type = detail::tree_node<R>::kind::directory;
+		root.parent = nullptr;
+
+		std::vector<detail::tree_node<R>*> files;
+		detail::scan_directory<R>(path, &root, files, -1, nullptr, nullptr);
+		detail::hash_nodes<N, R>(path, files, seed, detail::default_worker_count(worker_count));
+		detail::update_digests<N, R>(&root, seed);
+
+		return root.digest;
+	}
+
+	/* Keeps the digest of the directory tree at root up to date, watching it with inotify on a background thread. Changes are applied once the tree has been quiet for coalesce,
+	 * or at most ten times that after the first of them, with the changed files hashed on worker_count threads. The tree is hashed in full by the constructor,
+	 * and again whenever the kernel drops events. Directories below the root that can't be watched make the watcher degraded(), and are scanned again in full
+	 * with every change, and every meow_watch_rescan. Throws std::system_error if root isn't a readable directory, or inotify isn't available. */
+	template <size_t N = 128, size_t R = N>
+	class meow_directory_watcher
+	{
+	public:
+
+		static_assert(N == 128 || N == 256 || N == 512, "meow_directory_watcher can only be declared in 128, 256, or 512 bit mode.");
+
+		explicit meow_directory_watcher(const std::string& root, uint64_t seed = 0, unsigned worker_count = 0, std::chrono::milliseconds coalesce = meow_watch_coalesce) :
+			root_path(root), seed(seed), worker_count(detail::default_worker_count(worker_count)), coalesce(coalesce),
+			inotify(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC)), stop(::eventfd(0, EFD_CLOEXEC))
+		{
+			if (inotify.get() < 0 || stop.get() < 0)
+			{
+				detail::throw_file_error("meowh::meow_directory_watcher: inotify_init1");
+			}
+
+			rebuild();
+
+			if (tree->watch < 0)
+			{
+				detail::throw_file_error("meowh::meow_directory_watcher: inotify_add_watch");
+			}
+
+			watcher = std::thread([this]() { run(); });
+		}
+
+		meow_directory_watcher(const meow_directory_watcher&) = delete;
+		meow_directory_watcher& operator=(const meow_directory_watcher&) = delete;
+
+		~meow_directory_watcher()
+		{
+			uint64_t one = 1;
+			while (::write(stop.get(), &one, sizeof(one)) < 0 && errno == EINTR) {}
+			watcher.join();
+		}
+
+		// The digest of the whole tree, as of the last applied change.
+		hash_t<R> digest() const
+		{
+			std::lock_guard<std::mutex> guard(digest_lock);
+			return current_digest;
+		}
+
+		/* Whether some directories couldn't be watched, usually because the inotify watch limit (fs.inotify.max_user_watches) was reached.
+		 * Changes in them are only found by scanning them again, so they show up in the digest up to meow_watch_rescan late. */
+		bool degraded() const
+		{
+			std::lock_guard<std::mutex> guard(tree_lock);
+			return !unwatched.empty();
+		}
+
+		// Number of times the changes to the tree have been applied successfully, starting at 0 after the constructor.
+		uint64_t generation() const
+		{
+			return current_generation;
+		}
+
+		// The paths of all files and symbolic links in the tree, relative to the root, with their digests.
+		std::vector<std::pair<std::string, hash_t<R>>> manifest() const
+		{
+			std::lock_guard<std::mutex> guard(tree_lock);
+			std::vector<std::pair<std::string, hash_t<R>>> entries;
+			list(tree.get(), "", entries);
+			return entries;
+		}
+
+	private:
+
+		using node = detail::tree_node<R>;
+
+		// Drops the whole tree and its watches, and hashes it again from scratch.
+		void rebuild()
+		{
+			if (tree)
+			{
+				forget(tree.get());
+			}
+			unwatched.clear();
+
+			tree.reset(new node());
+			tree->type = node::kind::directory;
+			tree->parent = nullptr;
+
+			std::vector<node*> files;
+			detail::scan_directory<R>(root_path, tree.get(), files, inotify.get(), &watches, &unwatched);
+			detail::hash_nodes<N, R>(root_path, files, seed, worker_count);
+			detail::update_digests<N, R>(tree.get(), seed);
+
+			publish();
+		}
+
+		void publish()
+		{
+			std::lock_guard<std::mutex> guard(digest_lock);
+			current_digest = tree->digest;
+		}
+
+		// Removes the watches of a subtree that's about to be dropped.
+		void forget(node* subtree)
+		{
+			unwatched.erase(subtree);
+
+			if (subtree->watch >= 0)
+			{
+				auto found = watches.find(subtree->watch);
+
+				if (found != watches.end() && found->second == subtree)
+				{
+					::inotify_rm_watch(inotify.get(), subtree->watch);
+					watches.erase(found);
+				}
+			}
+
+			for (auto& child : subtree->children)
+			{
+				forget(child.second.get());
+			}
+		}
+
+		// Drops the entries of the directories that couldn't be watched, and scans them again, trying to watch them again too.
+		void rescan_unwatched(std::vector<node*>& files)
+		{
+			std::vector<node*> rescan;
+
+			for (node* dir : unwatched)
+			{
+				bool nested = false;
+
+				for (node* above = dir->parent; above != nullptr && !nested; above = above->parent)
+				{
+					nested = unwatched.count(above) != 0;
+				}
+
+				if (!nested)
+				{
+					rescan.push_back(dir);
+				}
+			}
+
+			for (node* dir : rescan)
+			{
+				for (auto& child : dir->children)
+				{
+					forget(child.second.get());
+				}
+
+				dir->children.clear();
+				unwatched.erase(dir);
+				detail::mark_stale(dir);
+				detail::scan_directory<R>(detail::node_path(root_path, dir), dir, files, inotify.get(), &watches, &unwatched);
+			}
+		}
+
+		void list(const node* dir, const std::string& prefix, std::vector<std::pair<std::string, hash_t<R>>>& entries) const
+		{
+			for (const auto& child : dir->children)
+			{
+				if (child.second->type == node::kind::directory)
+				{
+					list(child.second.get(), prefix + child.first + "/", entries);
+				}
+				else
+				{
+					entries.emplace_back(prefix + child.first, child.second->digest);
+				}
+			}
+		}
+
+		void run()
+		{
+			// The changed entries, as the watch of their directory and their name, and whether they were created or moved in, rather than changed in place.
+			std::map<std::pair<int, std::string>, bool> changes;
+			bool overflow = false;
+			auto first_change = std::chrono::steady_clock::now();
+
+			alignas(inotify_event) char events[64 * 1024];
+
+			for (;;)
+			{
+				pollfd fds[2] = { { inotify.get(), POLLIN, 0 }, { stop.get(), POLLIN, 0 } };
+				bool pending = overflow || !changes.empty();
+				bool rescan = !pending && degraded();
+
+				int ret = ::poll(fds, 2, pending ? static_cast<int>(coalesce.count()) : rescan ? static_cast<int>(meow_watch_rescan.count()) : -1);
+
+				if (ret < 0 && errno != EINTR)
+				{
+					return;
+				}
+				else if (fds[1].revents != 0)
+				{
+					return;
+				}
+
+				if (ret > 0 && (fds[0].revents & POLLIN) != 0)
+				{
+					ssize_t len = ::read(inotify.get(), events, sizeof(events));
+
+					for (ssize_t offset = 0; offset < len;)
+					{
+						const inotify_event* event = reinterpret_cast<const inotify_event*>(events + offset);
+						offset += sizeof(inotify_event) + event->len;
+
+						if (!overflow && changes.empty())
+						{
+							first_change = std::chrono::steady_clock::now();
+						}
+
+						if ((event->mask & IN_Q_OVERFLOW) != 0)
+						{
+							overflow = true;
+						}
+						else if ((event->mask & IN_IGNORED) != 0)
+						{
+							std::lock_guard<std::mutex> guard(tree_lock);
+							auto found = watches.find(event->wd);
+
+							if (found != watches.end())
+							{
+								found->second->watch = -1;
+								watches.erase(found);
+							}
+						}
+						else if (event->len > 0)
+						{
+							changes[std::make_pair(event->wd, std::string(event->name))] |= (event->mask & (IN_CREATE | IN_MOVED_TO)) != 0;
+						}
+					}
+				}
+
+				bool quiet = ret == 0 || std::chrono::steady_clock::now() - first_change >= coalesce * 10;
+
+				// With nothing else changing, the directories that couldn't be watched are scanned again, and only a change in their digest counts as a generation.
+				if (rescan && ret == 0)
+				{
+					try
+					{
+						std::lock_guard<std::mutex> guard(tree_lock);
+						hash_t<R> previous = tree->digest;
+
+						apply(changes);
+
+						if (std::memcmp(previous.elem.data(), tree->digest.elem.data(), 64) != 0)
+						{
+							current_generation++;
+						}
+					}
+					catch (...)
+					{
+						// As with the changes below, a failure leaves the previous digest in place.
+					}
+				}
+				else if (quiet && (overflow || !changes.empty()))
+				{
+					try
+					{
+						std::lock_guard<std::mutex> guard(tree_lock);
+
+						if (overflow)
+						{
+							rebuild();
+						}
+						else
+						{
+							apply(changes);
+						}
+
+						current_generation++;
+					}
+					catch (...)
+					{
+						// A failure to apply the changes, like running out of memory, leaves the previous digest and generation in place, to be replaced by the next change.
+					}
+
+					changes.clear();
+					overflow = false;
+				}
+			}
+		}
+
+		void apply(const std::map<std::pair<int, std::string>, bool>& changes)
+		{
+			std::vector<node*> files;
+
+			// Entries that are gone, changed their type, or were replaced are dropped first, so that a directory moved within the tree doesn't lose the watch it gets at its new place.
+			for (const auto& change : changes)
+			{
+				auto dir = watches.find(change.first.first);
+
+				if (dir == watches.end())
+				{
+					continue;
+				}
+
+				auto child = dir->second->children.find(change.first.second);
+
+				if (child == dir->second->children.end())
+				{
+					continue;
+				}
+
+				struct stat entry_stat;
+				std::string path = detail::node_path(root_path, child->second.get());
+				bool gone = ::lstat(path.c_str(), &entry_stat) != 0 || change.second ||
+					S_ISDIR(entry_stat.st_mode) != (child->second->type == node::kind::directory);
+
+				if (gone)
+				{
+					forget(child->second.get());
+					detail::mark_stale(dir->second);
+					dir->second->children.erase(child);
+				}
+			}
+
+			rescan_unwatched(files);
+
+			for (const auto& change : changes)
+			{
+				auto dir = watches.find(change.first.first);
+
+				if (dir == watches.end())
+				{
+					continue;
+				}
+
+				node* parent = dir->second;
+				std::string path = detail::node_path(root_path, parent) + "/" + change.first.second;
+				struct stat entry_stat;
+
+				if (::lstat(path.c_str(), &entry_stat) != 0)
+				{
+					continue;
+				}
+
+				auto child = parent->children.find(change.first.second);
+
+				if (child != parent->children.end())
+				{
+					// Directories changed in place are followed through their own watch.
+					if (child->second->type != node::kind::directory)
+					{
+						files.push_back(child->second.get());
+					}
+					continue;
+				}
+
+				std::unique_ptr<node> created(new node());
+				created->parent = parent;
+				created->name = change.first.second;
+
+				if (S_ISDIR(entry_stat.st_mode))
+				{
+					created->type = node::kind::directory;
+					detail::scan_directory<R>(path, created.get(), files, inotify.get(), &watches, &unwatched);
+				}
+				else if (S_ISREG(entry_stat.st_mode) || S_ISLNK(entry_stat.st_mode))
+				{
+					created->type = S_ISREG(entry_stat.st_mode) ? node::kind::file : node::kind::symlink;
+					files.push_back(created.get());
+				}
+				else
+				{
+					continue;
+				}
+
+				detail::mark_stale(parent);
+				parent->children[created->name] = std::move(created);
+			}
+
+			// A directory moved within the tree keeps its watch, so its entries can be both rescanned and reported as changed.
+			std::sort(files.begin(), files.end());
+			files.erase(std::unique(files.begin(), files.end()), files.end());
+
+			detail::hash_nodes<N, R>(root_path, files, seed, worker_count);
+			detail::update_digests<N, R>(tree.get(), seed);
+
+			publish();
+		}
+
+		std::string root_path;
+		uint64_t seed;
+		unsigned worker_count;
+		std::chrono::milliseconds coalesce;
+
+		detail::file_handle inotify;
+		detail::file_handle stop;
+
+		mutable std::mutex tree_lock;
+		std::unique_ptr<node> tree;
+		std::map<int, node*> watches;
+		std::set<node*> unwatched;
+
+		mutable std::mutex digest_lock;
+		hash_t<R> current_digest;
+		std::atomic<uint64_t> current_generation { 0 };
+
+		std::thread watcher;
+	};
+}
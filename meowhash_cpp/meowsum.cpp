@@ -0,0 +1,598 @@
+#include "meow_hash_file.hpp"
+#include "meow_hash_cache.hpp"
+
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* meowsum - prints or checks 128 bit Meow hashes of files, with the same interface and output format as sha256sum.
+ * The files are hashed in parallel, on a pool of --jobs threads. Small files are read with plain reads, and larger ones are mapped by meowh::hash_file.
+ * Input in memory is hashed through meowh::meow_hash_dispatch, so the same binary uses VAES on the machines that have it.
+ * Pipes and devices longer than meowh::meow_file_chunk_size are hashed with MeowStream, in constant memory, so their checksums differ from those of the same bytes in a file.
+ * With --cache, the hashes of files that didn't change since the last run are taken from a meowh::meow_hash_cache, without reading the files.
+ * A new cache gets room for --cache-capacity files, which should be about twice the number of files it's used for. */
+
+namespace
+{
+	// Below this size, reading a file into a buffer is cheaper than setting up and tearing down a mapping.
+	constexpr size_t small_file_size = 64 * 1024;
+
+#ifdef _MEOWH_DISPATCH
+	constexpr size_t hash_width = meowh::meow_file_dispatch;
+
+	meowh::hash_t<128> hash_buffer(const uint8_t* src, size_t len)
+	{
+		return meowh::meow_hash_dispatch<128>(src, len);
+	}
+#else
+	constexpr size_t hash_width = 128;
+
+	meowh::hash_t<128> hash_buffer(const uint8_t* src, size_t len)
+	{
+		return meowh::meow_hash<128>(src, len);
+	}
+#endif
+
+	constexpr const char usage[] =
+		"Usage: meowsum [OPTION]... [FILE]...\n"
+		"Print or check 128-bit Meow hash checksums.\n"
+		"\n"
+		"With no FILE, or when FILE is -, read standard input.\n"
+		"\n"
+		"  -b, --binary          read in binary mode (the only mode, accepted for compatibility)\n"
+		"  -c, --check           read checksums from the FILEs and check them\n"
+		"      --cache=CACHE     keep the hashes of files in CACHE, and skip files that didn't change\n"
+		"      --cache-capacity=N  create CACHE with room for N files, about twice the number\n"
+		"                        of files to hash (1048576 by default, 144 bytes each)\n"
+		"  -j, --jobs=N          hash N files at once, the number of CPUs by default\n"
+		"  -t, --text            read in text mode (same as binary, accepted for compatibility)\n"
+		"  -z, --zero            end each output line with NUL, not newline\n"
+		"\n"
+		"The following five options are useful only when verifying checksums:\n"
+		"      --ignore-missing  don't fail or report status for missing files\n"
+		"      --quiet           don't print OK for each successfully verified file\n"
+		"      --status          don't output anything, status code shows success\n"
+		"      --strict          exit non-zero for improperly formatted checksum lines\n"
+		"  -w, --warn            warn about improperly formatted checksum lines\n"
+		"\n"
+		"      --help            display this help and exit\n"
+		"      --version         output version information and exit\n";
+
+	struct options
+	{
+		bool check = false;
+		bool zero = false;
+		bool ignore_missing = false;
+		bool quiet = false;
+		bool status = false;
+		bool strict = false;
+		bool warn = false;
+		unsigned jobs = 0;
+		std::string cache_path;
+		size_t cache_capacity = 0;
+		meowh::meow_hash_cache* cache = nullptr;
+		std::vector<std::string> files;
+	};
+
+	struct file_result
+	{
+		meowh::hash_t<128> hash;
+		int error = 0;
+	};
+
+	std::string to_hex(const meowh::hash_t<128>& hash)
+	{
+		static constexpr char digits[] = "0123456789abcdef";
+
+		uint8_t bytes[16];
+		std::memcpy(bytes, hash.elem.data(), sizeof(bytes));
+
+		std::string hex(32, '0');
+		for (size_t k = 0; k < 16; k++)
+		{
+			hex[2 * k] = digits[bytes[k] >> 4];
+			hex[2 * k + 1] = digits[bytes[k] & 15];
+		}
+		return hex;
+	}
+
+	// File names with a backslash or a newline are escaped, and their lines start with a backslash, same as in sha256sum.
+	bool needs_escape(const std::string& name)
+	{
+		return name.find_first_of("\\\n") != std::string::npos;
+	}
+
+	std::string escape(const std::string& name)
+	{
+		std::string escaped;
+		for (char c : name)
+		{
+			if (c == '\\')
+			{
+				escaped += "\\\\";
+			}
+			else if (c == '\n')
+			{
+				escaped += "\\n";
+			}
+			else
+			{
+				escaped += c;
+			}
+		}
+		return escaped;
+	}
+
+	bool unescape(const std::string& escaped, std::string& name)
+	{
+		name.clear();
+		for (size_t k = 0; k < escaped.size(); k++)
+		{
+			if (escaped[k] != '\\')
+			{
+				name += escaped[k];
+			}
+			else if (k + 1 < escaped.size() && escaped[k + 1] == '\\')
+			{
+				name += '\\';
+				k++;
+			}
+			else if (k + 1 < escaped.size() && escaped[k + 1] == 'n')
+			{
+				name += '\n';
+				k++;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	meowh::hash_t<128> hash_path(const std::string& path, meowh::meow_hash_cache* cache)
+	{
+		if (path == "-")
+		{
+			return meowh::hash_file<hash_width, 128>(STDIN_FILENO);
+		}
+		else if (cache != nullptr)
+		{
+			return cache->hash_file<hash_width, 128>(path);
+		}
+
+		meowh::detail::file_handle file(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+		struct stat file_stat;
+
+		if (file.get() < 0 || ::fstat(file.get(), &file_stat) != 0)
+		{
+			meowh::detail::throw_file_error(path.c_str());
+		}
+
+		if (S_ISREG(file_stat.st_mode) && file_stat.st_size > 0 && static_cast<uint64_t>(file_stat.st_size) < small_file_size)
+		{
+			// One byte more than the size, so that a file that grew in the meantime is still hashed to its end.
+			thread_local std::vector<uint8_t> buffer(small_file_size + 1);
+
+			size_t len = meowh::detail::read_fully(file.get(), buffer.data(), buffer.size(), 0);
+			if (len < buffer.size())
+			{
+				return hash_buffer(buffer.data(), len);
+			}
+		}
+
+		return meowh::hash_file<hash_width, 128>(file.get());
+	}
+
+	/* Hashes the files on a pool of threads, and calls report(index, result) on the calling thread for each of them,
+	 * either in the order of paths, or in the order they finish in. */
+	template <typename F>
+	void hash_all(const std::vector<std::string>& paths, unsigned jobs, bool ordered, meowh::meow_hash_cache* cache, F report)
+	{
+		std::vector<file_result> results(paths.size());
+		std::vector<char> done(paths.size(), 0);
+		std::deque<size_t> finished;
+
+		std::mutex lock;
+		std::condition_variable progress;
+		std::atomic<size_t> next(0);
+
+		auto worker = [&]()
+		{
+			for (size_t k = next.fetch_add(1); k < paths.size(); k = next.fetch_add(1))
+			{
+				file_result result;
+
+				try
+				{
+					result.hash = hash_path(paths[k], cache);
+				}
+				catch (const std::system_error& e)
+				{
+					result.error = e.code().value();
+				}
+
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					results[k] = result;
+					done[k] = 1;
+					finished.push_back(k);
+				}
+				progress.notify_one();
+			}
+		};
+
+		std::vector<std::thread> workers;
+		for (unsigned w = 0; w < jobs; w++)
+		{
+			try
+			{
+				workers.emplace_back(worker);
+			}
+			catch (const std::system_error&)
+			{
+				break;
+			}
+		}
+
+		if (workers.empty())
+		{
+			worker();
+		}
+
+		for (size_t p = 0; p < paths.size(); p++)
+		{
+			size_t k;
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				progress.wait(guard, [&]() { return ordered ? done[p] != 0 : !finished.empty(); });
+
+				k = ordered ? p : finished.front();
+				finished.pop_front();
+			}
+
+			report(k, results[k]);
+		}
+
+		for (std::thread& thread : workers)
+		{
+			thread.join();
+		}
+	}
+
+	void print_error(const std::string& path, int error)
+	{
+		std::fprintf(stderr, "meowsum: %s: %s\n", path.c_str(), std::strerror(error));
+	}
+
+	int print_sums(const options& opts)
+	{
+		int status = 0;
+		char end = opts.zero ? '\0' : '\n';
+
+		hash_all(opts.files, opts.jobs, true, opts.cache, [&](size_t k, const file_result& result)
+		{
+			const std::string& path = opts.files[k];
+
+			if (result.error != 0)
+			{
+				print_error(path, result.error);
+				status = 1;
+				return;
+			}
+
+			bool escaped = !opts.zero && needs_escape(path);
+			std::string line = (escaped ? "\\" : "") + to_hex(result.hash) + "  " + (escaped ? escape(path) : path) + end;
+			std::fwrite(line.data(), 1, line.size(), stdout);
+		});
+
+		return status;
+	}
+
+	// Parses a line of the form "<32 hex digits>  <name>", or with " *" before the name for files hashed in binary mode.
+	bool parse_check_line(std::string line, std::string& hex, std::string& name)
+	{
+		bool escaped = !line.empty() && line[0] == '\\';
+		if (escaped)
+		{
+			line.erase(0, 1);
+		}
+
+		if (line.size() < 35 || line[32] != ' ' || (line[33] != ' ' && line[33] != '*'))
+		{
+			return false;
+		}
+
+		hex = line.substr(0, 32);
+		for (char& c : hex)
+		{
+			if (!std::isxdigit(static_cast<unsigned char>(c)))
+			{
+				return false;
+			}
+			c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+		}
+
+		if (escaped)
+		{
+			return unescape(line.substr(34), name);
+		}
+
+		name = line.substr(34);
+		return true;
+	}
+
+	int check_sums(const options& opts)
+	{
+		int status = 0;
+
+		for (const std::string& manifest : opts.files)
+		{
+			std::ifstream manifest_file;
+			if (manifest != "-")
+			{
+				manifest_file.open(manifest);
+				if (!manifest_file)
+				{
+					print_error(manifest, errno);
+					status = 1;
+					continue;
+				}
+			}
+			std::istream& input = manifest == "-" ? std::cin : manifest_file;
+
+			std::vector<std::string> names;
+			std::vector<std::string> expected;
+			size_t improper = 0;
+			size_t line_number = 0;
+
+			std::string line;
+			while (std::getline(input, line, opts.zero ? '\0' : '\n'))
+			{
+				line_number++;
+
+				std::string hex;
+				std::string name;
+
+				if (parse_check_line(line, hex, name))
+				{
+					names.push_back(name);
+					expected.push_back(hex);
+				}
+				else
+				{
+					improper++;
+					if (opts.warn)
+					{
+						std::fprintf(stderr, "meowsum: %s: %zu: improperly formatted Meow hash checksum line\n", manifest.c_str(), line_number);
+					}
+				}
+			}
+
+			if (names.empty())
+			{
+				std::fprintf(stderr, "meowsum: %s: no properly formatted Meow hash checksum lines found\n", manifest.c_str());
+				status = 1;
+				continue;
+			}
+
+			size_t mismatched = 0;
+			size_t unreadable = 0;
+			size_t verified = 0;
+
+			// Mismatches are reported as soon as they're found, rather than in the order of the manifest.
+			hash_all(names, opts.jobs, false, opts.cache, [&](size_t k, const file_result& result)
+			{
+				const std::string& name = names[k];
+
+				if (result.error != 0)
+				{
+					if (result.error == ENOENT && opts.ignore_missing)
+					{
+						return;
+					}
+
+					unreadable++;
+					if (!opts.status)
+					{
+						print_error(name, result.error);
+						std::printf("%s: FAILED open or read\n", name.c_str());
+					}
+					return;
+				}
+
+				verified++;
+
+				if (to_hex(result.hash) != expected[k])
+				{
+					mismatched++;
+					if (!opts.status)
+					{
+						std::printf("%s: FAILED\n", name.c_str());
+						std::fflush(stdout);
+					}
+				}
+				else if (!opts.status && !opts.quiet)
+				{
+					std::printf("%s: OK\n", name.c_str());
+				}
+			});
+
+			if (!opts.status)
+			{
+				if (improper > 0)
+				{
+					std::fprintf(stderr, "meowsum: WARNING: %zu line%s improperly formatted\n", improper, improper == 1 ? " is" : "s are");
+				}
+				if (unreadable > 0)
+				{
+					std::fprintf(stderr, "meowsum: WARNING: %zu listed file%s could not be read\n", unreadable, unreadable == 1 ? "" : "s");
+				}
+				if (mismatched > 0)
+				{
+					std::fprintf(stderr, "meowsum: WARNING: %zu computed checksum%s did NOT match\n", mismatched, mismatched == 1 ? "" : "s");
+				}
+				if (verified == 0 && opts.ignore_missing)
+				{
+					std::fprintf(stderr, "meowsum: %s: no file was verified\n", manifest.c_str());
+				}
+			}
+
+			if (mismatched > 0 || unreadable > 0 || (opts.strict && improper > 0) || (verified == 0 && opts.ignore_missing))
+			{
+				status = 1;
+			}
+		}
+
+		return status;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	options opts;
+	bool only_files = false;
+
+	for (int a = 1; a < argc; a++)
+	{
+		std::string arg = argv[a];
+
+		if (only_files || arg == "-" || arg[0] != '-')
+		{
+			opts.files.push_back(arg);
+		}
+		else if (arg == "--")
+		{
+			only_files = true;
+		}
+		else if (arg == "-c" || arg == "--check")
+		{
+			opts.check = true;
+		}
+		else if (arg == "--cache-capacity" || arg.compare(0, 17, "--cache-capacity=") == 0)
+		{
+			std::string value = arg == "--cache-capacity" ? (a + 1 < argc ? argv[++a] : "") : arg.substr(17);
+			char* value_end = nullptr;
+			unsigned long long capacity = std::strtoull(value.c_str(), &value_end, 10);
+
+			if (value.empty() || *value_end != '\0' || capacity == 0)
+			{
+				std::fprintf(stderr, "meowsum: invalid cache capacity: '%s'\n", value.c_str());
+				return 1;
+			}
+			opts.cache_capacity = static_cast<size_t>(capacity);
+		}
+		else if (arg == "--cache" || arg.compare(0, 8, "--cache=") == 0)
+		{
+			opts.cache_path = arg == "--cache" ? (a + 1 < argc ? argv[++a] : "") : arg.substr(8);
+
+			if (opts.cache_path.empty())
+			{
+				std::fprintf(stderr, "meowsum: option '--cache' requires a file\n");
+				return 1;
+			}
+		}
+		else if (arg == "-b" || arg == "--binary" || arg == "-t" || arg == "--text")
+		{
+		}
+		else if (arg == "-z" || arg == "--zero")
+		{
+			opts.zero = true;
+		}
+		else if (arg == "--ignore-missing")
+		{
+			opts.ignore_missing = true;
+		}
+		else if (arg == "--quiet")
+		{
+			opts.quiet = true;
+		}
+		else if (arg == "--status")
+		{
+			opts.status = true;
+		}
+		else if (arg == "--strict")
+		{
+			opts.strict = true;
+		}
+		else if (arg == "-w" || arg == "--warn")
+		{
+			opts.warn = true;
+		}
+		else if (arg == "-j" || arg.compare(0, 7, "--jobs=") == 0 || (arg.compare(0, 2, "-j") == 0 && arg.size() > 2))
+		{
+			std::string value = arg == "-j" ? (a + 1 < argc ? argv[++a] : "") : arg.substr(arg[1] == 'j' ? 2 : 7);
+			char* value_end = nullptr;
+			unsigned long jobs = std::strtoul(value.c_str(), &value_end, 10);
+
+			if (value.empty() || *value_end != '\0' || jobs == 0)
+			{
+				std::fprintf(stderr, "meowsum: invalid number of jobs: '%s'\n", value.c_str());
+				return 1;
+			}
+			opts.jobs = static_cast<unsigned>(jobs);
+		}
+		else if (arg == "--help")
+		{
+			std::fputs(usage, stdout);
+			return 0;
+		}
+		else if (arg == "--version")
+		{
+			std::printf("meowsum, Meow hash %s\n", meowh::meow_hash_version_name);
+			return 0;
+		}
+		else
+		{
+			std::fprintf(stderr, "meowsum: unrecognized option '%s'\nTry 'meowsum --help' for more information.\n", arg.c_str());
+			return 1;
+		}
+	}
+
+	if (opts.files.empty())
+	{
+		opts.files.push_back("-");
+	}
+
+	if (opts.jobs == 0)
+	{
+		opts.jobs = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	std::unique_ptr<meowh::meow_hash_cache> cache;
+
+	if (!opts.cache_path.empty())
+	{
+		try
+		{
+			cache.reset(new meowh::meow_hash_cache(opts.cache_path, opts.cache_capacity > 0 ? opts.cache_capacity : meowh::meow_cache_capacity));
+			opts.cache = cache.get();
+
+			// The capacity of an existing cache doesn't change, so asking for more takes a new cache file.
+			if (opts.cache_capacity > cache->capacity())
+			{
+				std::fprintf(stderr, "meowsum: %s: WARNING: the cache has room for %zu files; remove it to create it with room for %zu\n",
+					opts.cache_path.c_str(), cache->capacity(), opts.cache_capacity);
+			}
+		}
+		catch (const std::system_error& e)
+		{
+			std::fprintf(stderr, "meowsum: %s: %s\n", opts.cache_path.c_str(), std::strerror(e.code().value()));
+			return 1;
+		}
+	}
+
+	return opts.check ? check_sums(opts) : print_sums(opts);
+}
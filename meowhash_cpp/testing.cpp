@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <numeric>
 #include <cmath>
+#include <deque>
+#include <list>
 #include <stdlib.h>
 
 #ifdef _MSC_VER
@@ -13,6 +15,27 @@
 #include "meow_hash.hpp"
 #include "meow_hash.h"
 
+#if defined(__unix__) || defined(__APPLE__)
+#define MEOWH_TEST_FILES
+#include "meow_hash_file.hpp"
+#include "meow_hash_cache.hpp"
+#include <sys/uio.h>
+#endif
+
+// io_uring needs kernel headers from Linux 5.1 or newer.
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define MEOWH_TEST_URING
+#include "meow_hash_uring.hpp"
+#endif
+
+#ifdef __linux__
+#include "meow_hash_scan.hpp"
+#include "meow_hash_pipe.hpp"
+#include "meow_hash_watch.hpp"
+#include <ftw.h>
+#include <sys/wait.h>
+#endif
+
 
 #define CATCH_CONFIG_RUNNER
 #include "catch.hpp"
@@ -332,7 +355,7 @@ TEST_CASE("Results are the same as the original implementation for large, random
 		meowh::hash_t<128> res_hpp = meowh::meow_hash<128>(input_buffer, seed);
 
 #ifdef _MEOWH_512
-		REQUIRE(cmp(res_h.Q0, res_hpp[0].as<512>(0));
+		REQUIRE(cmp(res_h.Q0, res_hpp.as<512>(0)));
 #endif
 
 #ifdef _MEOWH_256
@@ -359,3 +382,1520 @@ TEST_CASE("Results are the same as the original implementation for large, random
 	}
 
 }
+
+TEST_CASE("Incremental hashing gives the same results as hashing the whole input at once", "[state]")
+{
+	constexpr int32_t test_num = 64;
+
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	for (int i = 0; i < test_num; i++)
+	{
+		std::vector<uint8_t> input_buffer(dist(rng) % (1 << 16));
+		std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+		meowh::meow_state<128> state(input_buffer.size(), seed);
+
+		for (size_t pos = 0; pos < input_buffer.size();)
+		{
+			size_t chunk = std::min<size_t>(dist(rng) % 700, input_buffer.size() - pos);
+			state.absorb(input_buffer.data() + pos, chunk);
+			pos += chunk;
+		}
+
+		meowh::hash_t<64> res_state = state.finalize();
+		meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer, seed);
+
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(res_state[k] == res_hpp[k]);
+		}
+	}
+}
+
+#ifdef _MEOWH_DISPATCH
+TEST_CASE("All kernels supported by the CPU give the same results as MeowHash1", "[dispatch]")
+{
+	constexpr int32_t test_num = 64;
+
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	size_t width = meowh::meow_hash_dispatch_width();
+
+	for (int i = 0; i < test_num; i++)
+	{
+		std::vector<uint8_t> input_buffer(dist(rng) % (1 << 16));
+		std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+		meow_lane res_h = MeowHash1(seed, input_buffer.size(), input_buffer.data());
+		meowh::hash_t<64> res_dispatch = meowh::meow_hash_dispatch<64>(input_buffer.data(), input_buffer.size(), seed);
+
+		std::vector<meowh::hash_t<64>> res_kernels = { meowh::detail::meow_hash_kernel_soft<64>(input_buffer.data(), input_buffer.size(), seed) };
+
+		if (width >= 128)
+		{
+			res_kernels.push_back(meowh::detail::meow_hash_kernel_128<64>(input_buffer.data(), input_buffer.size(), seed));
+		}
+		if (width >= 256)
+		{
+			res_kernels.push_back(meowh::detail::meow_hash_kernel_256<64>(input_buffer.data(), input_buffer.size(), seed));
+		}
+		if (width >= 512)
+		{
+			res_kernels.push_back(meowh::detail::meow_hash_kernel_512<64>(input_buffer.data(), input_buffer.size(), seed));
+		}
+
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(res_h.Sub[k] == res_dispatch[k]);
+
+			for (const meowh::hash_t<64>& res_kernel : res_kernels)
+			{
+				REQUIRE(res_h.Sub[k] == res_kernel[k]);
+			}
+		}
+	}
+}
+#endif
+
+TEST_CASE("Hashing on several threads gives the same results as hashing on one", "[parallel]")
+{
+	constexpr int32_t test_num = 16;
+
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	for (int i = 0; i < test_num; i++)
+	{
+		std::vector<uint8_t> input_buffer(dist(rng) % (1 << 20));
+		std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+		meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer, seed);
+
+		for (size_t threads : { 2, 4, 8, 16 })
+		{
+			meowh::hash_t<64> res_parallel = meowh::meow_hash_parallel<128>(input_buffer.data(), input_buffer.size(), seed, 0, threads);
+
+			for (int k = 0; k < 8; k++)
+			{
+				REQUIRE(res_parallel[k] == res_hpp[k]);
+			}
+		}
+	}
+}
+
+TEST_CASE("Batch hashing gives the same results as hashing each message separately", "[batch]")
+{
+	constexpr int32_t test_num = 16;
+	constexpr size_t batch_size = 37;
+
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	for (int i = 0; i < test_num; i++)
+	{
+		std::vector<std::vector<uint8_t>> messages(batch_size);
+		std::vector<const void*> inputs;
+		std::vector<size_t> lens;
+
+		for (std::vector<uint8_t>& message : messages)
+		{
+			// Half of the messages are shorter than a block, which is where the messages are finalized together.
+			message.resize(dist(rng) % 2 ? dist(rng) % 256 : dist(rng) % 5000);
+			std::generate(message.begin(), message.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+			inputs.push_back(message.data());
+			lens.push_back(message.size());
+		}
+
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+		std::vector<meowh::hash_t<64>> res_batch(batch_size);
+		meowh::meow_hash_batch<128, 64>(inputs.data(), lens.data(), res_batch.data(), batch_size, seed);
+
+#ifdef _MEOWH_256
+		std::vector<meowh::hash_t<64>> res_batch_256(batch_size);
+		meowh::meow_hash_batch<256, 64>(inputs.data(), lens.data(), res_batch_256.data(), batch_size, seed);
+#endif
+
+#ifdef _MEOWH_512
+		std::vector<meowh::hash_t<64>> res_batch_512(batch_size);
+		meowh::meow_hash_batch<512, 64>(inputs.data(), lens.data(), res_batch_512.data(), batch_size, seed);
+#endif
+
+		for (size_t m = 0; m < batch_size; m++)
+		{
+			meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(messages[m], seed);
+
+			for (int k = 0; k < 8; k++)
+			{
+				REQUIRE(res_batch[m][k] == res_hpp[k]);
+#ifdef _MEOWH_256
+				REQUIRE(res_batch_256[m][k] == res_hpp[k]);
+#endif
+#ifdef _MEOWH_512
+				REQUIRE(res_batch_512[m][k] == res_hpp[k]);
+#endif
+			}
+		}
+	}
+}
+
+TEST_CASE("Truncated hashes are the same as the beginning of the full hash", "[trunc]")
+{
+	constexpr int32_t test_num = 256;
+
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	for (int i = 0; i < test_num; i++)
+	{
+		std::vector<uint8_t> input_buffer(dist(rng) % 2000);
+		std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+		meowh::hash_t<128> res_hpp = meowh::meow_hash<128>(input_buffer, seed);
+
+		REQUIRE(meowh::meow_hash_trunc<128, 32>(input_buffer.data(), input_buffer.size(), seed) == res_hpp.as<32>(0));
+		REQUIRE(meowh::meow_hash_trunc<128, 64>(input_buffer.data(), input_buffer.size(), seed) == res_hpp.as<64>(0));
+		REQUIRE(cmp(meowh::meow_hash_trunc<128, 128>(input_buffer.data(), input_buffer.size(), seed), res_hpp[0]));
+	}
+}
+
+TEST_CASE("Results are the same as the original implementation for every input length around the block size", "[compatibility]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(600);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	for (size_t len = 0; len <= input_buffer.size(); len++)
+	{
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+		// Copies the input to its own buffer, so that reading past its end can be caught by sanitizers.
+		std::vector<uint8_t> input(input_buffer.begin(), input_buffer.begin() + len);
+
+		meow_lane res_h = MeowHash1(seed, len, input.data());
+		meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input.data(), len, seed);
+
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(res_h.Sub[k] == res_hpp[k]);
+		}
+	}
+}
+
+template <size_t Len>
+void check_fixed_length(const std::vector<uint8_t>& input_buffer, uint64_t seed)
+{
+	meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer.data(), Len, seed);
+	meowh::hash_t<64> res_fixed = meowh::meow_hash_fixed<128, Len>(input_buffer.data(), seed);
+
+	std::array<uint8_t, Len> input_array;
+	std::copy(input_buffer.begin(), input_buffer.begin() + Len, input_array.begin());
+	meowh::hash_t<64> res_array = meowh::meow_hash<128>(input_array, seed);
+
+	for (int k = 0; k < 8; k++)
+	{
+		REQUIRE(res_fixed[k] == res_hpp[k]);
+		REQUIRE(res_array[k] == res_hpp[k]);
+	}
+}
+
+TEST_CASE("Hashing inputs of a length known at compile time gives the same results as of a runtime length", "[fixed]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(20000);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+	check_fixed_length<1>(input_buffer, seed);
+	check_fixed_length<16>(input_buffer, seed);
+	check_fixed_length<64>(input_buffer, seed);
+	check_fixed_length<255>(input_buffer, seed);
+	check_fixed_length<256>(input_buffer, seed);
+	check_fixed_length<300>(input_buffer, seed);
+	check_fixed_length<4096>(input_buffer, seed);
+	check_fixed_length<4097>(input_buffer, seed);
+	check_fixed_length<20000>(input_buffer, seed);
+}
+
+TEST_CASE("Hashing at compile time gives the same results as at runtime", "[constexpr]")
+{
+	using namespace meowh::literals;
+
+	constexpr uint64_t literal_hash = "Meow hash at compile time"_meow64;
+	constexpr meowh::hash_t<64> literal_full_hash = "Meow hash at compile time"_meow;
+	static_assert(literal_hash == literal_full_hash[0], "meow_hash_ct is evaluated at compile time");
+
+	std::string literal_input = "Meow hash at compile time";
+	REQUIRE(literal_hash == meowh::meow_hash<128>(literal_input.data(), literal_input.size()).as<64>(0));
+
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<char> input_buffer(1200);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<char>(dist(rng)); });
+
+	for (size_t len : { 0, 1, 15, 16, 17, 100, 255, 256, 257, 512, 1000, 1200 })
+	{
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+		meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer.data(), len, seed);
+		meowh::hash_t<64> res_ct = meowh::meow_hash_ct(std::string_view(input_buffer.data(), len), seed);
+
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(res_ct[k] == res_hpp[k]);
+		}
+	}
+}
+
+TEST_CASE("Tree hashing hashes the concatenated leaf digests, regardless of the number of threads", "[tree]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	const size_t leaf_size = meowh::meow_tree_leaf_size;
+
+	std::vector<uint8_t> input_buffer(3 * leaf_size + 12345);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+	for (size_t len : { size_t(0), size_t(1000), leaf_size, leaf_size + 1, input_buffer.size() })
+	{
+		std::vector<meowh::hash_t<64>> leaves;
+		for (size_t offset = 0; offset < len || leaves.empty(); offset += leaf_size)
+		{
+			leaves.push_back(meowh::meow_hash<128>(input_buffer.data() + offset, std::min(len - offset, leaf_size), seed));
+		}
+
+		meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(leaves.data(), leaves.size() * sizeof(meowh::hash_t<64>), seed);
+
+		for (size_t threads : { 1, 2, 3, 8 })
+		{
+			meowh::hash_t<64> res_tree = meowh::meow_tree_hash<128>(input_buffer.data(), len, seed, threads);
+
+			for (int k = 0; k < 8; k++)
+			{
+				REQUIRE(res_tree[k] == res_hpp[k]);
+			}
+		}
+	}
+}
+
+TEST_CASE("Hashing with software prefetching gives the same results as without", "[prefetch]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(100000);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	for (size_t len : { 0, 100, 256, 2048, 2303, 2304, 5000, 100000 })
+	{
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+		meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer.data(), len, seed);
+		meowh::hash_t<64> res_temporal = meowh::meow_hash_prefetch<128>(input_buffer.data(), len, seed);
+		meowh::hash_t<64> res_non_temporal = meowh::meow_hash_prefetch<128, meowh::meow_prefetch::non_temporal, 512>(input_buffer.data(), len, seed);
+
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(res_temporal[k] == res_hpp[k]);
+			REQUIRE(res_non_temporal[k] == res_hpp[k]);
+		}
+	}
+}
+
+TEST_CASE("Cancelled hashing resumes to the same results as uninterrupted hashing", "[cancel]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(10 * 256 * 64 + 1000);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	for (size_t len : { size_t(0), size_t(100), size_t(256 * 64), input_buffer.size() })
+	{
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+		meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer.data(), len, seed);
+
+		std::atomic<bool> cancel(false);
+		std::vector<uint64_t> reports;
+
+		// Cancelled from the progress callback after the third report, and resumed.
+		meowh::meow_state<128, 64> state = meowh::meow_hash_cancellable<128, 64>(input_buffer.data(), len, seed, cancel, [&](uint64_t absorbed, uint64_t total) {
+			REQUIRE(total == len);
+			reports.push_back(absorbed);
+			cancel = reports.size() == 3;
+		}, 64);
+
+		REQUIRE(state.bytes_absorbed() == std::min<uint64_t>(len, 3 * 64 * 256));
+		REQUIRE(meowh::meow_hash_resume(state, input_buffer.data(), cancel) == (state.bytes_absorbed() == len));
+
+		cancel = false;
+		REQUIRE(meowh::meow_hash_resume(state, input_buffer.data(), cancel, [&](uint64_t absorbed, uint64_t) { reports.push_back(absorbed); }, 64));
+		REQUIRE(state.bytes_absorbed() == len);
+		REQUIRE(std::is_sorted(reports.begin(), reports.end()));
+		REQUIRE((len == 0 || reports.back() == len));
+
+		meowh::hash_t<64> res_cancellable = state.finalize();
+
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(res_cancellable[k] == res_hpp[k]);
+		}
+	}
+}
+
+TEST_CASE("Streaming hashing of input of unknown length gives the same results in any chunks", "[stream]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(100000);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	for (size_t len : { size_t(0), size_t(1), size_t(255), size_t(256), size_t(257), size_t(4096), input_buffer.size() })
+	{
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+		meowh::hash_t<64> res_stream = meowh::meow_hash_stream<128, false, 64>(input_buffer.data(), len, seed);
+		meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer.data(), len, seed);
+
+		meowh::meow_stream<128, 64> stream(seed);
+		for (size_t offset = 0; offset < len;)
+		{
+			size_t chunk_len = std::min<size_t>(dist(rng) % 700, len - offset);
+			stream.absorb(input_buffer.data() + offset, chunk_len);
+			offset += chunk_len;
+		}
+
+		REQUIRE(stream.bytes_absorbed() == len);
+		meowh::hash_t<64> res_chunked = stream.finalize();
+
+#ifdef _MEOWH_256
+		meowh::hash_t<64> res_stream_256 = meowh::meow_hash_stream<256, false, 64>(input_buffer.data(), len, seed);
+#else
+		meowh::hash_t<64> res_stream_256 = res_stream;
+#endif
+
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(res_chunked[k] == res_stream[k]);
+			REQUIRE(res_stream_256[k] == res_stream[k]);
+		}
+
+		// MeowStream is a different hash than meow_hash.
+		REQUIRE_FALSE(std::equal(res_stream.elem.begin(), res_stream.elem.end(), res_hpp.elem.begin()));
+	}
+
+	// The length folded into the finalization tells apart a partial block from a full block that ends with the padding.
+	std::array<uint8_t, 256> padded;
+	meowh::hash_t<64> init_vector = meowh::detail::make_stream_init_vector(0);
+	std::memcpy(padded.data(), init_vector.elem.data(), 64);
+	std::memcpy(padded.data() + 64, init_vector.elem.data(), 64);
+	std::memcpy(padded.data() + 128, init_vector.elem.data(), 64);
+	std::memcpy(padded.data() + 192, init_vector.elem.data(), 64);
+	std::memcpy(padded.data(), input_buffer.data(), 100);
+
+	meowh::hash_t<64> res_partial = meowh::meow_hash_stream<128, false, 64>(padded.data(), 100);
+	meowh::hash_t<64> res_full = meowh::meow_hash_stream<128, false, 64>(padded.data(), 256);
+	REQUIRE_FALSE(std::equal(res_partial.elem.begin(), res_partial.elem.end(), res_full.elem.begin()));
+}
+
+TEST_CASE("Hashing resumed from a checkpoint gives the same results as uninterrupted hashing", "[checkpoint]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(100000);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	for (size_t split : { size_t(0), size_t(100), size_t(256), size_t(50000), size_t(77777) })
+	{
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+		meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer.data(), input_buffer.size(), seed);
+		meowh::hash_t<64> res_stream_hpp = meowh::meow_hash_stream<128, false, 64>(input_buffer.data(), input_buffer.size(), seed);
+
+		meowh::meow_state<128, 64> state(input_buffer.size(), seed);
+		meowh::meow_stream<128, 64> stream(seed);
+		state.absorb(input_buffer.data(), split);
+		stream.absorb(input_buffer.data(), split);
+
+		std::vector<uint8_t> state_checkpoint = state.checkpoint();
+		std::vector<uint8_t> stream_checkpoint = stream.checkpoint();
+		REQUIRE(state_checkpoint.size() == 304 + split % 256);
+
+		// Restored into hashers that started out with other lengths and seeds.
+		meowh::meow_state<128, 64> resumed_state(1);
+		meowh::meow_stream<128, 64> resumed_stream(1);
+		REQUIRE(resumed_state.restore(state_checkpoint));
+		REQUIRE(resumed_stream.restore(stream_checkpoint));
+		REQUIRE(resumed_state.bytes_absorbed() == split);
+
+		resumed_state.absorb(input_buffer.data() + split, input_buffer.size() - split);
+		resumed_stream.absorb(input_buffer.data() + split, input_buffer.size() - split);
+
+		meowh::hash_t<64> res_state = resumed_state.finalize();
+		meowh::hash_t<64> res_stream = resumed_stream.finalize();
+
+#ifdef _MEOWH_256
+		// The lanes are stored in the same order for every width.
+		meowh::meow_state<256, 64> resumed_state_256(1);
+		REQUIRE(resumed_state_256.restore(state_checkpoint));
+		resumed_state_256.absorb(input_buffer.data() + split, input_buffer.size() - split);
+		meowh::hash_t<64> res_state_256 = resumed_state_256.finalize();
+#else
+		meowh::hash_t<64> res_state_256 = res_state;
+#endif
+
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(res_state[k] == res_hpp[k]);
+			REQUIRE(res_stream[k] == res_stream_hpp[k]);
+			REQUIRE(res_state_256[k] == res_hpp[k]);
+		}
+
+		// Damaged checkpoints, and checkpoints of the other hasher, are rejected without changing the state.
+		REQUIRE_FALSE(resumed_state.restore(stream_checkpoint));
+		REQUIRE_FALSE(resumed_stream.restore(state_checkpoint));
+		REQUIRE_FALSE(resumed_state.restore(state_checkpoint.data(), state_checkpoint.size() - 1));
+
+		// A checkpoint with a valid check value, that claims more bytes absorbed than the total length, is rejected too.
+		if (split > 0)
+		{
+			std::vector<uint8_t> overrun_checkpoint = state_checkpoint;
+			uint64_t overrun_len = split - 1;
+			std::memcpy(overrun_checkpoint.data() + 24, &overrun_len, sizeof(overrun_len));
+			uint64_t check = meowh::detail::checkpoint_check(overrun_checkpoint);
+			std::memcpy(overrun_checkpoint.data() + meowh::detail::checkpoint_check_offset, &check, sizeof(check));
+			REQUIRE_FALSE(resumed_state.restore(overrun_checkpoint));
+		}
+
+		state_checkpoint[100] ^= 1;
+		REQUIRE_FALSE(resumed_state.restore(state_checkpoint));
+		REQUIRE(resumed_state.bytes_absorbed() == input_buffer.size());
+
+		meowh::hash_t<64> res_rejected = resumed_state.finalize();
+		meowh::hash_t<64> res_stream_rejected = resumed_stream.finalize();
+
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(res_rejected[k] == res_hpp[k]);
+			REQUIRE(res_stream_rejected[k] == res_stream_hpp[k]);
+		}
+	}
+}
+
+TEST_CASE("Hashing lists of segments gives the same results as hashing their concatenation", "[scatter]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(100000);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	for (size_t max_segment : { size_t(1), size_t(7), size_t(300), size_t(5000) })
+	{
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+		size_t len = dist(rng) % input_buffer.size();
+
+		// Segments of random sizes, some of them empty, cut out of the input.
+		std::vector<std::string_view> views;
+		for (size_t offset = 0; offset < len;)
+		{
+			size_t segment_len = std::min<size_t>(dist(rng) % (max_segment + 1), len - offset);
+			views.emplace_back(reinterpret_cast<const char*>(input_buffer.data()) + offset, segment_len);
+			offset += segment_len;
+		}
+
+		std::vector<std::vector<uint8_t>> copies;
+		for (std::string_view view : views)
+		{
+			copies.emplace_back(view.begin(), view.end());
+		}
+
+		meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer.data(), len, seed);
+		meowh::hash_t<64> res_views = meowh::meow_hash_v<128, 64>(views, seed);
+		meowh::hash_t<64> res_copies = meowh::meow_hash_v<128, 64>(copies, seed);
+		meowh::hash_t<64> res_pointer = meowh::meow_hash_v<128, 64>(views.data(), views.size(), seed);
+
+#ifdef MEOWH_TEST_FILES
+		std::vector<iovec> iovecs;
+		for (std::string_view view : views)
+		{
+			iovecs.push_back({ const_cast<char*>(view.data()), view.size() });
+		}
+
+		meowh::hash_t<64> res_iovecs = meowh::meow_hash_v<128, 64>(iovecs.data(), iovecs.size(), seed);
+#else
+		meowh::hash_t<64> res_iovecs = res_hpp;
+#endif
+
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(res_views[k] == res_hpp[k]);
+			REQUIRE(res_copies[k] == res_hpp[k]);
+			REQUIRE(res_pointer[k] == res_hpp[k]);
+			REQUIRE(res_iovecs[k] == res_hpp[k]);
+		}
+	}
+
+	// Segments of wider elements count their size in bytes.
+	std::vector<std::vector<uint32_t>> words = { { 1, 2, 3 }, {}, { 4, 5 } };
+	std::vector<uint32_t> joined = { 1, 2, 3, 4, 5 };
+
+	meowh::hash_t<64> res_words = meowh::meow_hash_v<128, 64>(words);
+	meowh::hash_t<64> res_joined = meowh::meow_hash<128>(joined);
+
+	for (int k = 0; k < 8; k++)
+	{
+		REQUIRE(res_words[k] == res_joined[k]);
+	}
+}
+
+TEST_CASE("Hashing non-contiguous ranges gives the same results as hashing a contiguous copy of them", "[range]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	for (size_t len : { size_t(0), size_t(1), size_t(300), size_t(5000), size_t(100000) })
+	{
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+		std::vector<uint8_t> bytes(len);
+		std::generate(bytes.begin(), bytes.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+		std::vector<uint32_t> words(len);
+		std::generate(words.begin(), words.end(), [&rng, &dist]() {return dist(rng); });
+		std::vector<uint8_t> bits(len);
+		std::generate(bits.begin(), bits.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng) % 2); });
+
+		std::deque<uint8_t> byte_deque(bytes.begin(), bytes.end());
+		std::deque<uint32_t> word_deque(words.begin(), words.end());
+		std::list<uint32_t> word_list(words.begin(), words.end());
+		std::vector<bool> bool_vector(bits.begin(), bits.end());
+
+		// Grown at the front, so that the first block is only partly filled, and with elements whose size doesn't divide the size of the blocks.
+		struct rgb { uint8_t c[3]; };
+		std::deque<uint8_t> front_deque;
+		std::deque<rgb> rgb_deque(len / 3);
+
+		for (auto b = bytes.rbegin(); b != bytes.rend(); ++b)
+		{
+			front_deque.push_front(*b);
+		}
+		for (size_t p = 0; p < rgb_deque.size(); p++)
+		{
+			std::memcpy(rgb_deque[p].c, bytes.data() + 3 * p, 3);
+		}
+
+		size_t cut = std::min<size_t>(len / 2, 7);
+		meowh::hash_t<64> res_bytes_cut = meowh::meow_hash<128>(bytes.data() + cut, len - 2 * cut, seed);
+		meowh::hash_t<64> res_rgb = meowh::meow_hash<128>(bytes.data(), rgb_deque.size() * 3, seed);
+
+		meowh::hash_t<64> res_bytes = meowh::meow_hash<128>(bytes.data(), bytes.size(), seed);
+		meowh::hash_t<64> res_words = meowh::meow_hash<128>(words.data(), words.size() * sizeof(uint32_t), seed);
+		meowh::hash_t<64> res_bits = meowh::meow_hash<128>(bits.data(), bits.size(), seed);
+
+		meowh::hash_t<64> res_byte_deque = meowh::meow_hash_range<128, 64>(byte_deque, seed);
+		meowh::hash_t<64> res_word_deque = meowh::meow_hash<128, false, 64>(word_deque.begin(), word_deque.end(), seed);
+		meowh::hash_t<64> res_word_list = meowh::meow_hash_range<128, 64>(word_list, seed);
+		meowh::hash_t<64> res_bool_vector = meowh::meow_hash_range<128, 64>(bool_vector, seed);
+		meowh::hash_t<64> res_word_vector = meowh::meow_hash_range<128, 64>(words, seed);
+		meowh::hash_t<64> res_front_deque = meowh::meow_hash<128, false, 64>(front_deque.cbegin() + cut, front_deque.cend() - cut, seed);
+		meowh::hash_t<64> res_rgb_deque = meowh::meow_hash_range<128, 64>(rgb_deque, seed);
+
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(res_byte_deque[k] == res_bytes[k]);
+			REQUIRE(res_word_deque[k] == res_words[k]);
+			REQUIRE(res_word_list[k] == res_words[k]);
+			REQUIRE(res_bool_vector[k] == res_bits[k]);
+			REQUIRE(res_word_vector[k] == res_words[k]);
+			REQUIRE(res_front_deque[k] == res_bytes_cut[k]);
+			REQUIRE(res_rgb_deque[k] == res_rgb[k]);
+		}
+	}
+}
+
+TEST_CASE("Hashing strided views gives the same results as hashing the packed tiles", "[strided]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	constexpr size_t pitch = 1024 + 64;
+	constexpr size_t rows = 96;
+	constexpr size_t slices = 3;
+	constexpr size_t slice_pitch = pitch * rows + 4096;
+
+	std::vector<uint8_t> image(slice_pitch * slices);
+	std::generate(image.begin(), image.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	auto pack = [&image](const meowh::meow_strided_view& view, std::vector<uint8_t>& packed)
+	{
+		for (size_t slice = 0; slice < view.slices; slice++)
+		{
+			for (size_t row = 0; row < view.rows; row++)
+			{
+				const uint8_t* src = reinterpret_cast<const uint8_t*>(view.base) + slice * view.slice_pitch + row * view.pitch;
+				packed.insert(packed.end(), src, src + view.row_bytes);
+			}
+		}
+	};
+
+	// Tiles of a grid, with and without padding between the rows, a 3D view and a view whose rows follow each other in memory.
+	std::vector<meowh::meow_strided_view> views;
+
+	for (size_t x : { size_t(0), size_t(3), size_t(256), size_t(700) })
+	{
+		for (size_t width : { size_t(0), size_t(1), size_t(64), size_t(250), size_t(300) })
+		{
+			views.push_back({ image.data() + 7 * pitch + x, width, pitch, 13 });
+		}
+	}
+
+	views.push_back({ image.data() + 5, 1000, pitch, rows, slices, slice_pitch });
+	views.push_back({ image.data() + 5, 1000, 1000, 20, 2, 1000 * 20 });
+	views.push_back({ image.data(), pitch, pitch, 0 });
+
+	std::vector<meowh::hash_t<64>> res_batch(views.size());
+	meowh::meow_hash_strided_batch<128, 64>(views.data(), res_batch.data(), views.size(), 42);
+
+	std::vector<uint8_t> chain;
+
+	for (size_t k = 0; k < views.size(); k++)
+	{
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+		const meowh::meow_strided_view& view = views[k];
+
+		std::vector<uint8_t> packed;
+		pack(view, packed);
+		chain.insert(chain.end(), packed.begin(), packed.end());
+
+		meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(packed.data(), packed.size(), seed);
+		meowh::hash_t<64> res_view = meowh::meow_hash_strided<128, 64>(view, seed);
+		meowh::hash_t<64> res_args = view.slices == 1 ?
+			meowh::meow_hash_strided<128, 64>(view.base, view.row_bytes, view.pitch, view.rows, seed) :
+			meowh::meow_hash_strided<128, 64>(view.base, view.row_bytes, view.pitch, view.rows, view.slices, view.slice_pitch, seed);
+		meowh::hash_t<64> res_batch_hpp = meowh::meow_hash<128>(packed.data(), packed.size(), 42);
+
+		for (int j = 0; j < 8; j++)
+		{
+			REQUIRE(res_view[j] == res_hpp[j]);
+			REQUIRE(res_args[j] == res_hpp[j]);
+			REQUIRE(res_batch[k][j] == res_batch_hpp[j]);
+		}
+	}
+
+	// A mip chain, with each level half the size of the previous one, hashed as a single message.
+	std::vector<meowh::meow_strided_view> levels;
+	std::vector<uint8_t> packed_levels;
+
+	for (size_t width = 1024, height = rows, offset = 0; width > 0 && height > 0; offset += width * height, width /= 2, height /= 2)
+	{
+		levels.push_back({ image.data() + offset, width, width, height });
+		pack(levels.back(), packed_levels);
+	}
+
+	uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+	meowh::hash_t<64> res_levels_hpp = meowh::meow_hash<128>(packed_levels.data(), packed_levels.size(), seed);
+	meowh::hash_t<64> res_levels = meowh::meow_hash_strided<128, 64>(levels.data(), levels.size(), seed);
+	meowh::hash_t<64> res_chain_hpp = meowh::meow_hash<128>(chain.data(), chain.size(), seed);
+	meowh::hash_t<64> res_chain = meowh::meow_hash_strided<128, 64>(views.data(), views.size(), seed);
+
+	for (int j = 0; j < 8; j++)
+	{
+		REQUIRE(res_levels[j] == res_levels_hpp[j]);
+		REQUIRE(res_chain[j] == res_chain_hpp[j]);
+	}
+}
+
+#ifdef MEOWH_TEST_FILES
+TEST_CASE("Hashing files gives the same results as hashing their contents in memory", "[file]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(3 * meowh::meow_file_chunk_size + 1000);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	for (size_t len : { size_t(0), size_t(1), size_t(300), meowh::meow_file_chunk_size, input_buffer.size() })
+	{
+		char path[] = "/tmp/meowh_test_XXXXXX";
+		int fd = mkstemp(path);
+		REQUIRE(fd >= 0);
+		REQUIRE(write(fd, input_buffer.data(), len) == static_cast<ssize_t>(len));
+
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+		meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer.data(), len, seed);
+
+		// Input of unknown length is only hashed like meow_hash if it ends within the first chunk, and with MeowStream otherwise.
+		meowh::hash_t<64> res_stream_hpp = len < meowh::meow_file_chunk_size ? res_hpp : meowh::meow_hash_stream<128, false, 64>(input_buffer.data(), len, seed);
+
+		meowh::hash_t<64> res_path = meowh::hash_file(path, seed);
+		meowh::hash_t<64> res_fd = meowh::hash_file(fd, seed);
+		meowh::hash_t<64> res_chunked = meowh::detail::hash_file_chunked<128, 128>(fd, len, seed);
+
+		lseek(fd, 0, SEEK_SET);
+		meowh::hash_t<64> res_stream = meowh::detail::hash_file_stream<128, 128>(fd, seed);
+
+#ifdef _MEOWH_DISPATCH
+		meowh::hash_t<64> res_dispatch = meowh::hash_file<meowh::meow_file_dispatch, 64>(path, seed);
+		lseek(fd, 0, SEEK_SET);
+		meowh::hash_t<64> res_dispatch_stream = meowh::detail::hash_file_stream<meowh::meow_file_dispatch, 64>(fd, seed);
+#else
+		meowh::hash_t<64> res_dispatch = res_hpp;
+		meowh::hash_t<64> res_dispatch_stream = res_stream_hpp;
+#endif
+
+		close(fd);
+		unlink(path);
+
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(res_path[k] == res_hpp[k]);
+			REQUIRE(res_fd[k] == res_hpp[k]);
+			REQUIRE(res_chunked[k] == res_hpp[k]);
+			REQUIRE(res_stream[k] == res_stream_hpp[k]);
+			REQUIRE(res_dispatch[k] == res_hpp[k]);
+			REQUIRE(res_dispatch_stream[k] == res_stream_hpp[k]);
+		}
+	}
+
+	REQUIRE_THROWS_AS(meowh::hash_file("/nonexistent/meowh_test"), std::system_error);
+}
+
+TEST_CASE("Hashing files through the cache gives the same results, and skips unchanged files", "[cache]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(100000);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+	char cache_path[] = "/tmp/meowh_test_XXXXXX";
+	close(mkstemp(cache_path));
+
+	std::vector<std::string> paths;
+
+	for (size_t f = 0; f < 100; f++)
+	{
+		char path[] = "/tmp/meowh_test_XXXXXX";
+		int fd = mkstemp(path);
+		REQUIRE(fd >= 0);
+		REQUIRE(write(fd, input_buffer.data(), f * 1000) == static_cast<ssize_t>(f * 1000));
+		close(fd);
+		paths.push_back(path);
+	}
+
+	{
+		// Without the racy window, files are stored right after being written.
+		meowh::meow_hash_cache cache(cache_path, 1024, 0);
+		REQUIRE(cache.capacity() == 1024);
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (size_t f = 0; f < paths.size(); f++)
+			{
+				meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer.data(), f * 1000, seed);
+				meowh::hash_t<64> res_cache = cache.hash_file<128, 64>(paths[f], seed);
+
+				for (int k = 0; k < 8; k++)
+				{
+					REQUIRE(res_cache[k] == res_hpp[k]);
+				}
+			}
+		}
+
+		REQUIRE(cache.misses() == paths.size());
+		REQUIRE(cache.hits() == paths.size());
+	}
+
+	// Another instance sees the same entries, and a file changed without changing its size is hashed again.
+	meowh::meow_hash_cache shared_cache(cache_path, meowh::meow_cache_capacity, 0);
+	REQUIRE(shared_cache.capacity() == 1024);
+
+	int fd = open(paths[50].c_str(), O_WRONLY);
+	REQUIRE(fd >= 0);
+	REQUIRE(pwrite(fd, input_buffer.data() + 1, 1000, 0) == 1000);
+	close(fd);
+
+	std::vector<uint8_t> changed_buffer(input_buffer.begin() + 1, input_buffer.begin() + 1001);
+	changed_buffer.insert(changed_buffer.end(), input_buffer.begin() + 1000, input_buffer.begin() + 50000);
+
+	meowh::hash_t<64> res_changed_hpp = meowh::meow_hash<128>(changed_buffer.data(), changed_buffer.size(), seed);
+	meowh::hash_t<64> res_changed = shared_cache.hash_file<128, 64>(paths[50], seed);
+	meowh::hash_t<64> res_unchanged_hpp = meowh::meow_hash<128>(input_buffer.data(), 10000, seed);
+	meowh::hash_t<64> res_unchanged = shared_cache.hash_file<128, 64>(paths[10], seed);
+
+	REQUIRE(shared_cache.misses() == 1);
+
+	for (int k = 0; k < 8; k++)
+	{
+		REQUIRE(res_changed[k] == res_changed_hpp[k]);
+		REQUIRE(res_unchanged[k] == res_unchanged_hpp[k]);
+	}
+
+	// Slots left locked by writers that died, with an odd sequence, are taken over by the next writer, even when every slot is locked.
+	int cache_fd = open(cache_path, O_RDWR);
+	REQUIRE(cache_fd >= 0);
+
+	for (size_t slot = 0; slot < shared_cache.capacity(); slot++)
+	{
+		uint64_t sequence;
+		off_t offset = static_cast<off_t>(sizeof(meowh::detail::cache_header) + slot * sizeof(meowh::detail::cache_slot));
+		REQUIRE(pread(cache_fd, &sequence, sizeof(sequence), offset) == sizeof(sequence));
+
+		sequence++;
+		REQUIRE(pwrite(cache_fd, &sequence, sizeof(sequence), offset) == sizeof(sequence));
+	}
+	close(cache_fd);
+
+	shared_cache.hash_file<128, 64>(paths[20], seed);
+	meowh::hash_t<64> res_reclaimed = shared_cache.hash_file<128, 64>(paths[20], seed);
+	meowh::hash_t<64> res_reclaimed_hpp = meowh::meow_hash<128>(input_buffer.data(), 20000, seed);
+	REQUIRE(shared_cache.misses() == 2);
+
+	for (int k = 0; k < 8; k++)
+	{
+		REQUIRE(res_reclaimed[k] == res_reclaimed_hpp[k]);
+	}
+
+	// With the default racy window, files that were just written are hashed every time. The cache file was sized, but its creator died before writing the header.
+	char racy_cache_path[] = "/tmp/meowh_test_XXXXXX";
+	close(mkstemp(racy_cache_path));
+	REQUIRE(truncate(racy_cache_path, 1024 * 1024) == 0);
+
+	meowh::meow_hash_cache racy_cache(racy_cache_path);
+	racy_cache.hash_file(paths[0], seed);
+	racy_cache.hash_file(paths[0], seed);
+	REQUIRE(racy_cache.misses() == 2);
+
+	REQUIRE_THROWS_AS(meowh::meow_hash_cache(paths[99]), std::system_error);
+
+	for (const std::string& path : paths)
+	{
+		unlink(path.c_str());
+	}
+	unlink(cache_path);
+	unlink(racy_cache_path);
+}
+
+TEST_CASE("Hashing sparse files gives the same results as hashing their contents in memory", "[sparse]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(64 * 1024 * 1024 + 1000, 0);
+
+	char path[] = "/tmp/meowh_test_XXXXXX";
+	int fd = mkstemp(path);
+	REQUIRE(fd >= 0);
+	REQUIRE(ftruncate(fd, static_cast<off_t>(input_buffer.size())) == 0);
+
+	// A few islands of data, some of them not aligned to pages or blocks, between the holes.
+	for (size_t island : { size_t(0), size_t(5000000), size_t(33554432 + 123), input_buffer.size() - 777 })
+	{
+		size_t island_len = std::min<size_t>(dist(rng) % 300000 + 1, input_buffer.size() - island);
+		std::generate(input_buffer.begin() + island, input_buffer.begin() + island + island_len, [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+		REQUIRE(pwrite(fd, input_buffer.data() + island, island_len, static_cast<off_t>(island)) == static_cast<ssize_t>(island_len));
+	}
+
+	uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+	meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer.data(), input_buffer.size(), seed);
+
+	// The holes are found by seeking, which mustn't move the file offset of the caller.
+	REQUIRE(lseek(fd, 1234, SEEK_SET) == 1234);
+	meowh::hash_t<64> res_file = meowh::hash_file(fd, seed);
+	meowh::hash_t<64> res_sparse = meowh::detail::hash_file_sparse<128, 128>(fd, input_buffer.size(), seed);
+	REQUIRE(lseek(fd, 0, SEEK_CUR) == 1234);
+
+	close(fd);
+	unlink(path);
+
+	for (int k = 0; k < 8; k++)
+	{
+		REQUIRE(res_file[k] == res_hpp[k]);
+		REQUIRE(res_sparse[k] == res_hpp[k]);
+	}
+
+	// Zeros absorbed in pieces of any size, between pieces of data.
+	meowh::meow_state<128, 64> state(100000, seed);
+	std::vector<uint8_t> zeros_and_data(100000, 0);
+	size_t absorbed = 0;
+
+	while (absorbed < zeros_and_data.size())
+	{
+		size_t take = std::min<size_t>(dist(rng) % 2000, zeros_and_data.size() - absorbed);
+
+		if (dist(rng) % 2 == 0)
+		{
+			state.absorb_zeros(take);
+		}
+		else
+		{
+			std::generate(zeros_and_data.begin() + absorbed, zeros_and_data.begin() + absorbed + take, [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+			state.absorb(zeros_and_data.data() + absorbed, take);
+		}
+
+		absorbed += take;
+	}
+
+	meowh::hash_t<64> res_state = state.finalize();
+	meowh::hash_t<64> res_zeros_and_data = meowh::meow_hash<128>(zeros_and_data.data(), zeros_and_data.size(), seed);
+
+	for (int k = 0; k < 8; k++)
+	{
+		REQUIRE(res_state[k] == res_zeros_and_data[k]);
+	}
+}
+
+TEST_CASE("Hashing a pipe gives the same results as hashing what was written to it with MeowStream", "[file]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	// Several chunks, so that both buffers are read into more than once.
+	std::vector<uint8_t> input_buffer(4 * meowh::meow_file_chunk_size + 12345);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	int pipe_fds[2];
+	REQUIRE(pipe(pipe_fds) == 0);
+
+	std::thread writer([&]() {
+		size_t written = 0;
+		while (written < input_buffer.size())
+		{
+			ssize_t ret = write(pipe_fds[1], input_buffer.data() + written, input_buffer.size() - written);
+			if (ret <= 0)
+			{
+				break;
+			}
+			written += static_cast<size_t>(ret);
+		}
+		close(pipe_fds[1]);
+	});
+
+	meowh::hash_t<64> res_pipe = meowh::hash_file(pipe_fds[0]);
+	writer.join();
+	close(pipe_fds[0]);
+
+	meowh::hash_t<64> res_hpp = meowh::meow_hash_stream<128, false, 64>(input_buffer.data(), input_buffer.size());
+
+	for (int k = 0; k < 8; k++)
+	{
+		REQUIRE(res_pipe[k] == res_hpp[k]);
+	}
+}
+#endif
+
+#ifdef MEOWH_TEST_URING
+TEST_CASE("Hashing files in batches gives the same results as hashing them one by one", "[uring]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(100000);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+	std::vector<std::string> paths;
+	std::vector<meowh::hash_t<64>> expected;
+
+	for (size_t f = 0; f < 200; f++)
+	{
+		size_t len = dist(rng) % input_buffer.size();
+		char path[] = "/tmp/meowh_test_XXXXXX";
+		int fd = mkstemp(path);
+		REQUIRE(fd >= 0);
+		REQUIRE(write(fd, input_buffer.data(), len) == static_cast<ssize_t>(len));
+		close(fd);
+
+		paths.push_back(path);
+		expected.push_back(meowh::meow_hash<128>(input_buffer.data(), len, seed));
+	}
+
+	paths.push_back("/nonexistent/meowh_test");
+
+	// Small buffers, so that most files are read in several chunks.
+	meowh::meow_uring_engine<128, 64> engine(4, 8, 8192, 2);
+
+	// A callback that throws, here on the thread that drives the reads, stops the batch with reads in flight, and leaves the engine usable.
+	std::vector<std::string> interrupted_paths(paths.begin(), paths.end() - 1);
+	interrupted_paths.insert(interrupted_paths.begin() + 100, paths.back());
+
+	REQUIRE_THROWS_AS(engine.hash_files(interrupted_paths, [&](size_t, const meowh::hash_t<64>&, int error) {
+		if (error != 0)
+		{
+			throw std::runtime_error("interrupted");
+		}
+	}, seed), std::runtime_error);
+
+	std::mutex results_lock;
+	std::vector<meowh::hash_t<64>> results(paths.size());
+	std::vector<int> errors(paths.size(), -1);
+
+	engine.hash_files(paths, [&](size_t index, const meowh::hash_t<64>& hash, int error) {
+		std::lock_guard<std::mutex> guard(results_lock);
+		results[index] = hash;
+		errors[index] = error;
+	}, seed);
+
+	for (size_t f = 0; f < expected.size(); f++)
+	{
+		unlink(paths[f].c_str());
+
+		REQUIRE(errors[f] == 0);
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(results[f][k] == expected[f][k]);
+		}
+	}
+
+	REQUIRE(errors.back() == ENOENT);
+}
+
+TEST_CASE("Hashing files with O_DIRECT gives the same results as hashing their contents in memory", "[direct]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(5 * meowh::meow_direct_chunk_size + 12345);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	for (size_t len : { size_t(0), size_t(1), size_t(4095), size_t(4096), meowh::meow_direct_chunk_size, meowh::meow_direct_chunk_size + 1, input_buffer.size() })
+	{
+		char path[] = "/tmp/meowh_test_XXXXXX";
+		int fd = mkstemp(path);
+		REQUIRE(fd >= 0);
+		REQUIRE(write(fd, input_buffer.data(), len) == static_cast<ssize_t>(len));
+		close(fd);
+
+		uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+		meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer.data(), len, seed);
+
+		meowh::hash_t<64> res_direct = meowh::hash_file_direct(path, seed);
+		meowh::hash_t<64> res_direct_single = meowh::hash_file_direct(path, seed, 1);
+
+		unlink(path);
+
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(res_direct[k] == res_hpp[k]);
+			REQUIRE(res_direct_single[k] == res_hpp[k]);
+		}
+	}
+}
+#endif
+
+#ifdef __linux__
+TEST_CASE("Hashing files in the order of their physical location reports them in the original order", "[scan]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(100000);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+	char dir_path[] = "/tmp/meowh_test_XXXXXX";
+	REQUIRE(mkdtemp(dir_path) != nullptr);
+
+	std::vector<std::string> paths;
+	std::vector<meowh::hash_t<64>> expected;
+	std::vector<std::tuple<bool, uint64_t, size_t>> locations;
+
+	for (size_t f = 0; f < 100; f++)
+	{
+		size_t len = dist(rng) % input_buffer.size();
+		std::string path = std::string(dir_path) + "/" + std::to_string(f);
+		int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		REQUIRE(fd >= 0);
+		REQUIRE(write(fd, input_buffer.data(), len) == static_cast<ssize_t>(len));
+		REQUIRE(fsync(fd) == 0);
+		close(fd);
+
+		// The physical offset of the first extent, looked up separately from hash_files_by_extent.
+		fd = open(path.c_str(), O_RDONLY);
+		struct stat file_stat;
+		REQUIRE(fstat(fd, &file_stat) == 0);
+
+		alignas(fiemap) uint8_t request[sizeof(fiemap) + sizeof(fiemap_extent)] = {};
+		fiemap* map = reinterpret_cast<fiemap*>(request);
+		map->fm_length = FIEMAP_MAX_OFFSET;
+		map->fm_extent_count = 1;
+
+		bool mapped = ioctl(fd, FS_IOC_FIEMAP, map) == 0 && map->fm_mapped_extents > 0;
+		locations.emplace_back(!mapped, mapped ? map->fm_extents[0].fe_physical : static_cast<uint64_t>(file_stat.st_ino), f);
+		close(fd);
+
+		paths.push_back(path);
+		expected.push_back(meowh::meow_hash<128>(input_buffer.data(), len, seed));
+	}
+
+	paths.insert(paths.begin() + 50, "/nonexistent/meowh_test");
+	expected.insert(expected.begin() + 50, meowh::hash_t<64>(std::array<uint64_t, 8>{}));
+
+	std::stable_sort(locations.begin(), locations.end());
+
+	// Every file is closed after it's read, so the order of the close events on the directory is the order the files were read in.
+	int watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	REQUIRE(watch_fd >= 0);
+	REQUIRE(inotify_add_watch(watch_fd, dir_path, IN_CLOSE_NOWRITE) >= 0);
+
+	size_t next_index = 0;
+
+	// One worker reads the files one at a time, and with no readahead past the current file, the events of different files don't interleave.
+	meowh::hash_files_by_extent<128, 64>(paths, [&](size_t index, const meowh::hash_t<64>& hash, int error) {
+		REQUIRE(index == next_index++);
+
+		if (index == 50)
+		{
+			REQUIRE(error == ENOENT);
+			return;
+		}
+
+		REQUIRE(error == 0);
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(hash[k] == expected[index][k]);
+		}
+	}, seed, 1, 0);
+
+	REQUIRE(next_index == paths.size());
+
+	std::vector<size_t> closed;
+	alignas(inotify_event) char events[65536];
+
+	for (ssize_t n = read(watch_fd, events, sizeof(events)); n > 0; n = read(watch_fd, events, sizeof(events)))
+	{
+		for (char* at = events; at < events + n; at += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(at)->len)
+		{
+			closed.push_back(std::stoul(reinterpret_cast<inotify_event*>(at)->name));
+		}
+	}
+	close(watch_fd);
+
+	/* Every file is opened once to be located, in the order of paths, and then for its readahead and to be hashed, in the order of its location.
+	 * inotify merges identical events that follow each other, so repeats are merged on both sides. */
+	std::vector<size_t> opened(locations.size());
+	std::iota(opened.begin(), opened.end(), 0);
+	for (const auto& location : locations)
+	{
+		opened.push_back(std::get<2>(location));
+	}
+
+	opened.erase(std::unique(opened.begin(), opened.end()), opened.end());
+	closed.erase(std::unique(closed.begin(), closed.end()), closed.end());
+	REQUIRE(closed == opened);
+
+	for (const std::string& path : paths)
+	{
+		unlink(path.c_str());
+	}
+	rmdir(dir_path);
+
+	/* Files on two devices, /tmp and the tmpfs at /dev/shm, are read by threads bound to their device, so with one reader per device,
+	 * neither device ever has two of its files open at once, even after the other device is done. */
+	char disk_path[] = "/tmp/meowh_test_XXXXXX";
+	char shm_path[] = "/dev/shm/meowh_test_XXXXXX";
+
+	REQUIRE(mkdtemp(disk_path) != nullptr);
+
+	if (mkdtemp(shm_path) != nullptr)
+	{
+		std::vector<uint8_t> large_buffer(8 * 1024 * 1024);
+		std::generate(large_buffer.begin(), large_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+		std::vector<std::string> device_paths;
+		std::vector<meowh::hash_t<64>> device_expected;
+
+		for (size_t f = 0; f < 12; f++)
+		{
+			size_t len = large_buffer.size() - f * 1000;
+			std::string path = std::string(f % 2 == 0 ? disk_path : shm_path) + "/" + std::to_string(f);
+			int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+			REQUIRE(fd >= 0);
+			REQUIRE(write(fd, large_buffer.data(), len) == static_cast<ssize_t>(len));
+			close(fd);
+
+			device_paths.push_back(path);
+			device_expected.push_back(meowh::meow_hash<128>(large_buffer.data(), len, seed));
+		}
+
+		int device_watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		REQUIRE(device_watch_fd >= 0);
+		int disk_watch = inotify_add_watch(device_watch_fd, disk_path, IN_OPEN | IN_CLOSE_NOWRITE);
+		int shm_watch = inotify_add_watch(device_watch_fd, shm_path, IN_OPEN | IN_CLOSE_NOWRITE);
+		REQUIRE(disk_watch >= 0);
+		REQUIRE(shm_watch >= 0);
+
+		meowh::hash_files_by_extent<128, 64>(device_paths, [&](size_t index, const meowh::hash_t<64>& hash, int error) {
+			REQUIRE(error == 0);
+			for (int k = 0; k < 8; k++)
+			{
+				REQUIRE(hash[k] == device_expected[index][k]);
+			}
+		}, seed, 1, 0);
+
+		// The open files of each device are counted along the events, which arrive in the order they happened on both directories.
+		std::map<int, int> open_files;
+		std::map<int, int> most_open_files;
+
+		for (ssize_t n = read(device_watch_fd, events, sizeof(events)); n > 0; n = read(device_watch_fd, events, sizeof(events)))
+		{
+			for (char* at = events; at < events + n; at += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(at)->len)
+			{
+				const inotify_event* event = reinterpret_cast<inotify_event*>(at);
+				open_files[event->wd] += (event->mask & IN_OPEN) != 0 ? 1 : -1;
+				most_open_files[event->wd] = std::max(most_open_files[event->wd], open_files[event->wd]);
+			}
+		}
+		close(device_watch_fd);
+
+		REQUIRE(most_open_files[disk_watch] == 1);
+		REQUIRE(most_open_files[shm_watch] == 1);
+		REQUIRE(open_files[disk_watch] == 0);
+		REQUIRE(open_files[shm_watch] == 0);
+
+		for (const std::string& path : device_paths)
+		{
+			unlink(path.c_str());
+		}
+		rmdir(shm_path);
+	}
+	rmdir(disk_path);
+}
+
+TEST_CASE("Hashing pipe input gives the same results as hashing it in memory", "[pipe]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(3 * 1024 * 1024 + 1000);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+	std::vector<size_t> lens = { 0, 1, 300, 70000, input_buffer.size() };
+
+	// A small ring, so that it wraps around many times.
+	meowh::meow_pipe_hasher<128, 64> hasher(8192);
+
+	int pipe_fds[2];
+	REQUIRE(pipe(pipe_fds) == 0);
+
+	// Every message is written framed by its length, followed by one more message without the frame.
+	std::thread writer([&]() {
+		for (size_t len : lens)
+		{
+			uint8_t prefix[8];
+			for (int k = 0; k < 8; k++)
+			{
+				prefix[k] = static_cast<uint8_t>(static_cast<uint64_t>(len) >> (8 * k));
+			}
+
+			write(pipe_fds[1], prefix, sizeof(prefix));
+			write(pipe_fds[1], input_buffer.data(), len);
+		}
+
+		write(pipe_fds[1], input_buffer.data(), 5000);
+		close(pipe_fds[1]);
+	});
+
+	for (size_t len : lens)
+	{
+		meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer.data(), len, seed);
+		meowh::hash_t<64> res_pipe;
+
+		REQUIRE(hasher.hash_frame(pipe_fds[0], res_pipe, seed));
+
+		for (int k = 0; k < 8; k++)
+		{
+			REQUIRE(res_pipe[k] == res_hpp[k]);
+		}
+	}
+
+	meowh::hash_t<64> res_tail_hpp = meowh::meow_hash<128>(input_buffer.data(), 5000, seed);
+	meowh::hash_t<64> res_tail = hasher.hash(pipe_fds[0], 5000, seed);
+	meowh::hash_t<64> res_end;
+
+	REQUIRE_FALSE(hasher.hash_frame(pipe_fds[0], res_end, seed));
+
+	writer.join();
+	close(pipe_fds[0]);
+
+	for (int k = 0; k < 8; k++)
+	{
+		REQUIRE(res_tail[k] == res_tail_hpp[k]);
+	}
+
+	// Regular files can't be spliced into the ring, and are read into it instead.
+	char path[] = "/tmp/meowh_test_XXXXXX";
+	int fd = mkstemp(path);
+	REQUIRE(fd >= 0);
+	REQUIRE(write(fd, input_buffer.data(), input_buffer.size()) == static_cast<ssize_t>(input_buffer.size()));
+	lseek(fd, 0, SEEK_SET);
+
+	meowh::hash_t<64> res_hpp = meowh::meow_hash<128>(input_buffer.data(), input_buffer.size(), seed);
+	meowh::hash_t<64> res_file = meowh::hash_pipe<128, 64>(fd, input_buffer.size(), seed);
+
+	REQUIRE_THROWS_AS((meowh::hash_pipe<128, 64>(fd, 1, seed)), std::system_error);
+
+	close(fd);
+	unlink(path);
+
+	for (int k = 0; k < 8; k++)
+	{
+		REQUIRE(res_file[k] == res_hpp[k]);
+	}
+}
+
+TEST_CASE("Watching a directory tree keeps its digest the same as hashing it again", "[watch]")
+{
+	std::minstd_rand rng(std::chrono::system_clock::now().time_since_epoch().count());
+	std::uniform_int_distribution<uint32_t> dist(0, 4294967295U);
+
+	std::vector<uint8_t> input_buffer(100000);
+	std::generate(input_buffer.begin(), input_buffer.end(), [&rng, &dist]() {return static_cast<uint8_t>(dist(rng)); });
+
+	uint64_t seed = ((static_cast<uint64_t>(dist(rng)) << 32) + dist(rng));
+
+	char root_path[] = "/tmp/meowh_test_XXXXXX";
+	REQUIRE(mkdtemp(root_path) != nullptr);
+	std::string root = root_path;
+
+	auto write_file = [&](const std::string& path, size_t len) {
+		int fd = open((root + path).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		REQUIRE(fd >= 0);
+		REQUIRE(write(fd, input_buffer.data() + dist(rng) % 1000, len) == static_cast<ssize_t>(len));
+		close(fd);
+	};
+
+	REQUIRE(mkdir((root + "/sub").c_str(), 0755) == 0);
+	REQUIRE(mkdir((root + "/sub/deep").c_str(), 0755) == 0);
+	write_file("/a", 1000);
+	write_file("/sub/b", 50000);
+	write_file("/sub/deep/c", 300);
+
+	meowh::meow_directory_watcher<128, 64> watcher(root, seed, 2, std::chrono::milliseconds(20));
+	meowh::hash_t<64> res_initial = meowh::hash_directory<128, 64>(root, seed);
+	meowh::hash_t<64> res_watch = watcher.digest();
+
+	REQUIRE(watcher.manifest().size() == 3);
+	for (int k = 0; k < 8; k++)
+	{
+		REQUIRE(res_watch[k] == res_initial[k]);
+	}
+
+	// Every change is followed by waiting for the watcher to reach the digest of hashing the tree again.
+	auto require_caught_up = [&]() {
+		meowh::hash_t<64> res_hpp = meowh::hash_directory<128, 64>(root, seed);
+		bool same = false;
+
+		for (int attempt = 0; attempt < 500 && !same; attempt++)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			meowh::hash_t<64> res_current = watcher.digest();
+			same = std::equal(res_current.elem.begin(), res_current.elem.end(), res_hpp.elem.begin());
+		}
+
+		REQUIRE(same);
+	};
+
+	write_file("/sub/deep/c", 301);
+	require_caught_up();
+
+	REQUIRE(mkdir((root + "/new").c_str(), 0755) == 0);
+	write_file("/new/d", 70000);
+	write_file("/new/e", 0);
+	require_caught_up();
+
+	REQUIRE(rename((root + "/new").c_str(), (root + "/sub/moved").c_str()) == 0);
+	write_file("/sub/moved/f", 10);
+	require_caught_up();
+
+	REQUIRE(unlink((root + "/a").c_str()) == 0);
+	REQUIRE(symlink("sub/b", (root + "/link").c_str()) == 0);
+	require_caught_up();
+
+	REQUIRE(watcher.manifest().size() == 6);
+
+	meowh::hash_t<64> res_final = watcher.digest();
+	REQUIRE_FALSE(std::equal(res_final.elem.begin(), res_final.elem.end(), res_initial.elem.begin()));
+
+	nftw(root_path, [](const char* path, const struct stat*, int, FTW*) { return remove(path); }, 16, FTW_DEPTH | FTW_PHYS);
+
+	/* A directory without read permission can't be watched, which makes the watcher degraded, and it's scanned again until it can be.
+	 * Root can watch any directory, so this runs in a child process as nobody, which reports through its exit status. */
+	pid_t child = fork();
+	REQUIRE(child >= 0);
+
+	if (child == 0)
+	{
+		bool ok = getuid() != 0 || setuid(65534) == 0;
+		char locked_root_path[] = "/tmp/meowh_test_XXXXXX";
+		ok = ok && mkdtemp(locked_root_path) != nullptr;
+
+		std::string locked = std::string(locked_root_path) + "/locked";
+		int fd = -1;
+
+		if (ok && mkdir(locked.c_str(), 0700) == 0 && (fd = open((locked + "/g").c_str(), O_WRONLY | O_CREAT, 0600)) >= 0)
+		{
+			ok = write(fd, input_buffer.data(), 1000) == 1000 && chmod(locked.c_str(), 0300) == 0;
+			close(fd);
+
+			meowh::meow_directory_watcher<128, 64> locked_watcher(locked_root_path, seed, 1, std::chrono::milliseconds(20));
+			ok = ok && locked_watcher.degraded() && locked_watcher.manifest().empty();
+
+			// Changing the permissions isn't a watched event, so only the rescan finds the file.
+			ok = ok && chmod(locked.c_str(), 0700) == 0;
+
+			for (int attempt = 0; attempt < 500 && ok && locked_watcher.manifest().size() != 1; attempt++)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+
+			meowh::hash_t<64> res_locked_hpp = meowh::hash_directory<128, 64>(locked_root_path, seed);
+			meowh::hash_t<64> res_locked = locked_watcher.digest();
+			ok = ok && !locked_watcher.degraded() && std::equal(res_locked.elem.begin(), res_locked.elem.end(), res_locked_hpp.elem.begin());
+		}
+		else
+		{
+			ok = false;
+		}
+
+		unlink((locked + "/g").c_str());
+		rmdir(locked.c_str());
+		rmdir(locked_root_path);
+		_exit(ok ? 0 : 1);
+	}
+
+	int status = 0;
+	REQUIRE(waitpid(child, &status, 0) == child);
+	REQUIRE(WIFEXITED(status));
+	REQUIRE(WEXITSTATUS(status) == 0);
+}
+#endif